@@ -0,0 +1,202 @@
+#include "bit_packing.h"
+
+#include <algorithm>
+#include <array>
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BIT_PACKING_X86_64
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+	const size_t LANE_COUNT = 4;
+	const size_t LANE_SIZE = BIT_PACKING_BLOCK_SIZE / LANE_COUNT;
+
+	uint32_t GetMask(int bit_width)
+	{
+		return bit_width == 32 ? ~uint32_t{0} : (uint32_t{1} << bit_width) - 1;
+	}
+
+	[[maybe_unused]] void UnpackScalar(const uint32_t *words, int bit_width, uint32_t *values)
+	{
+		if (bit_width == 0)
+		{
+			// a block of width 0 has no words
+			fill(values, values + BIT_PACKING_BLOCK_SIZE, 0);
+			return;
+		}
+		const uint32_t mask = GetMask(bit_width);
+		for (size_t i = 0; i < LANE_SIZE; ++i)
+		{
+			const size_t bit = i * static_cast<size_t>(bit_width);
+			const size_t word = bit / 32;
+			const auto shift = static_cast<int>(bit % 32);
+			for (size_t lane = 0; lane < LANE_COUNT; ++lane)
+			{
+				uint32_t value = words[word * LANE_COUNT + lane] >> shift;
+				if (shift + bit_width > 32)
+				{
+					value |= words[(word + 1) * LANE_COUNT + lane] << (32 - shift);
+				}
+				values[i * LANE_COUNT + lane] = value & mask;
+			}
+		}
+	}
+
+#ifdef BIT_PACKING_X86_64
+	// Stores the unpacked values as they are
+	struct StoreValues
+	{
+		__m128i *output;
+
+		void operator()(size_t index, __m128i values)
+		{
+			_mm_storeu_si128(output + index, values);
+		}
+	};
+
+	// Stores the running sums of the unpacked gaps less one
+	struct StoreRunningSums
+	{
+		__m128i *output;
+		// the last value stored, in every lane
+		__m128i previous;
+
+		void operator()(size_t index, __m128i gaps)
+		{
+			__m128i values = _mm_add_epi32(gaps, _mm_set1_epi32(1));
+			values = _mm_add_epi32(values, _mm_slli_si128(values, 4));
+			values = _mm_add_epi32(values, _mm_slli_si128(values, 8));
+			values = _mm_add_epi32(values, previous);
+			_mm_storeu_si128(output + index, values);
+			previous = _mm_shuffle_epi32(values, _MM_SHUFFLE(3, 3, 3, 3));
+		}
+	};
+
+	// Unpacks value INDEX of every lane. The steps of a block are unrolled at compile time,
+	// so every shift is an immediate and no step branches.
+	template <int BIT_WIDTH, size_t INDEX, typename Store>
+	void UnpackStep(const __m128i *&input, __m128i &current, Store &store)
+	{
+		constexpr int SHIFT = static_cast<int>(INDEX * BIT_WIDTH % 32);
+		if constexpr (BIT_WIDTH == 0)
+		{
+			store(INDEX, _mm_setzero_si128());
+			return;
+		}
+		else
+		{
+			__m128i value = _mm_srli_epi32(current, SHIFT);
+			// the last value of a block may end exactly at the last word
+			if constexpr (SHIFT + BIT_WIDTH > 32 || (SHIFT + BIT_WIDTH == 32 && INDEX + 1 < LANE_SIZE))
+			{
+				current = _mm_loadu_si128(++input);
+			}
+			if constexpr (SHIFT + BIT_WIDTH > 32)
+			{
+				value = _mm_or_si128(value, _mm_slli_epi32(current, 32 - SHIFT));
+			}
+			if constexpr (BIT_WIDTH < 32)
+			{
+				value = _mm_and_si128(value, _mm_set1_epi32(static_cast<int>((uint32_t{1} << BIT_WIDTH) - 1)));
+			}
+			store(INDEX, value);
+		}
+	}
+
+	template <int BIT_WIDTH, typename Store, size_t... INDEXES>
+	void UnpackSteps(const uint32_t *words, Store &store, index_sequence<INDEXES...>)
+	{
+		const auto *input = reinterpret_cast<const __m128i *>(words);
+		// a block of width 0 has no words
+		__m128i current = BIT_WIDTH == 0 ? _mm_setzero_si128() : _mm_loadu_si128(input);
+		(UnpackStep<BIT_WIDTH, INDEXES>(input, current, store), ...);
+	}
+
+	// SSE2 is part of x86-64, so these kernels need no runtime check
+	template <int BIT_WIDTH, typename Store>
+	void UnpackSse2(const uint32_t *words, Store store)
+	{
+		UnpackSteps<BIT_WIDTH>(words, store, make_index_sequence<LANE_SIZE>{});
+	}
+
+	template <typename Store, size_t... BIT_WIDTHS>
+	constexpr array<void (*)(const uint32_t *, Store), sizeof...(BIT_WIDTHS)> MakeUnpackKernels(index_sequence<BIT_WIDTHS...>)
+	{
+		return {&UnpackSse2<static_cast<int>(BIT_WIDTHS), Store>...};
+	}
+
+	// kernels of every width from 0 to 32
+	template <typename Store>
+	void Unpack(const uint32_t *words, int bit_width, Store store)
+	{
+		static constexpr auto kernels = MakeUnpackKernels<Store>(make_index_sequence<33>{});
+		kernels[static_cast<size_t>(bit_width)](words, store);
+	}
+#endif
+}
+
+int GetBitWidth(uint32_t value)
+{
+	int bit_width = 0;
+	for (; value != 0; value >>= 1)
+	{
+		++bit_width;
+	}
+	return bit_width;
+}
+
+void PackBlock(const uint32_t *values, int bit_width, uint32_t *words)
+{
+	const size_t word_count = GetPackedWordCount(bit_width);
+	for (size_t word = 0; word < word_count; ++word)
+	{
+		words[word] = 0;
+	}
+	if (bit_width == 0)
+	{
+		return;
+	}
+	for (size_t i = 0; i < LANE_SIZE; ++i)
+	{
+		const size_t bit = i * static_cast<size_t>(bit_width);
+		const size_t word = bit / 32;
+		const auto shift = static_cast<int>(bit % 32);
+		for (size_t lane = 0; lane < LANE_COUNT; ++lane)
+		{
+			const uint32_t value = values[i * LANE_COUNT + lane];
+			words[word * LANE_COUNT + lane] |= value << shift;
+			if (shift + bit_width > 32)
+			{
+				words[(word + 1) * LANE_COUNT + lane] |= value >> (32 - shift);
+			}
+		}
+	}
+}
+
+void UnpackBlock(const uint32_t *words, int bit_width, uint32_t *values)
+{
+#ifdef BIT_PACKING_X86_64
+	Unpack(words, bit_width, StoreValues{reinterpret_cast<__m128i *>(values)});
+#else
+	UnpackScalar(words, bit_width, values);
+#endif
+}
+
+void UnpackIncreasingBlock(const uint32_t *words, int bit_width, uint32_t previous, uint32_t *values)
+{
+#ifdef BIT_PACKING_X86_64
+	Unpack(words, bit_width, StoreRunningSums{reinterpret_cast<__m128i *>(values), _mm_set1_epi32(static_cast<int>(previous))});
+#else
+	UnpackScalar(words, bit_width, values);
+	for (size_t i = 0; i < BIT_PACKING_BLOCK_SIZE; ++i)
+	{
+		previous += values[i] + 1;
+		values[i] = previous;
+	}
+#endif
+}
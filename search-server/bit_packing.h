@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Values are packed in blocks of 128, each value taking the same number of bits
+const size_t BIT_PACKING_BLOCK_SIZE = 128;
+
+// Smallest width that holds value, 0 for 0
+[[nodiscard]] int GetBitWidth(uint32_t value);
+
+// Number of 32-bit words a block of bit_width-bit values takes
+[[nodiscard]] inline size_t GetPackedWordCount(int bit_width)
+{
+	return BIT_PACKING_BLOCK_SIZE / 32 * static_cast<size_t>(bit_width);
+}
+
+// The block is split into 4 interleaved lanes, value i goes to lane i % 4 and every lane
+// packs its 32 values into its own sequence of words. Word j of a lane is words[4 * j + lane],
+// so one 128-bit load brings the same word of all lanes and the lanes unpack in parallel.
+// values must fit in bit_width bits; writes GetPackedWordCount(bit_width) words.
+void PackBlock(const uint32_t *values, int bit_width, uint32_t *words);
+// Reverses PackBlock into values[0, 128). Uses SSE2 kernels specialized for every bit width
+// where available and a scalar loop otherwise.
+void UnpackBlock(const uint32_t *words, int bit_width, uint32_t *values);
+// Reverses PackBlock of the gaps less one between the values of an increasing sequence:
+// values[i] = values[i - 1] + gap + 1, previous standing for values[-1]. The running sums
+// are taken in the same pass as the unpacking.
+void UnpackIncreasingBlock(const uint32_t *words, int bit_width, uint32_t previous, uint32_t *values);
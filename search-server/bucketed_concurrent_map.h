@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using namespace std::string_literals;
+
+// The ConcurrentMap the server used to score documents with: every access locks one of
+// bucket_count mutexes and looks the key up in that bucket's std::map. It is kept as the
+// baseline main.cpp measures the current scoring against.
+template <typename Key, typename Value>
+class BucketedConcurrentMap
+{
+private:
+    struct Bucket
+    {
+        std::mutex mutex;
+        std::map<Key, Value> map;
+    };
+
+public:
+    static_assert(std::is_integral_v<Key>, "BucketedConcurrentMap supports only integer keys"s);
+
+    struct Access
+    {
+        std::lock_guard<std::mutex> guard;
+        Value &ref_to_value;
+
+        Access(const Key &key, Bucket &bucket)
+            : guard(bucket.mutex), ref_to_value(bucket.map[key])
+        {
+        }
+    };
+
+    explicit BucketedConcurrentMap(size_t bucket_count)
+        : buckets_(bucket_count)
+    {
+    }
+
+    Access operator[](const Key &key)
+    {
+        auto &bucket = buckets_[static_cast<uint64_t>(key) % buckets_.size()];
+        return {key, bucket};
+    }
+
+    std::map<Key, Value> BuildOrdinaryMap()
+    {
+        std::map<Key, Value> result;
+        for (auto &[mutex, map] : buckets_)
+        {
+            std::lock_guard g(mutex);
+            result.insert(map.begin(), map.end());
+        }
+        return result;
+    }
+
+private:
+    std::vector<Bucket> buckets_;
+};
@@ -0,0 +1,142 @@
+#include "compressed_bitmap.h"
+
+#include <algorithm>
+
+using namespace std;
+
+void CompressedBitmap::Add(DocumentOrdinal ordinal)
+{
+	const size_t chunk_index = ordinal >> CHUNK_BITS;
+	const auto low = static_cast<uint16_t>(ordinal);
+	if (chunk_index >= chunks_.size())
+	{
+		chunks_.resize(chunk_index + 1);
+	}
+	Chunk &chunk = chunks_[chunk_index];
+
+	if (!chunk.bits.empty())
+	{
+		uint64_t &word = chunk.bits[low / 64];
+		const uint64_t bit = uint64_t{1} << (low % 64);
+		if ((word & bit) == 0)
+		{
+			word |= bit;
+			++chunk.size;
+			++size_;
+		}
+		return;
+	}
+
+	// ordinals are assigned in increasing order, so appending is the common case
+	if (chunk.values.empty() || chunk.values.back() < low)
+	{
+		chunk.values.push_back(low);
+	}
+	else
+	{
+		const auto it = lower_bound(chunk.values.begin(), chunk.values.end(), low);
+		if (*it == low)
+		{
+			return;
+		}
+		chunk.values.insert(it, low);
+	}
+	++chunk.size;
+	++size_;
+	if (chunk.size > ARRAY_LIMIT)
+	{
+		ToBitmap(chunk);
+	}
+}
+
+void CompressedBitmap::Remove(DocumentOrdinal ordinal)
+{
+	const size_t chunk_index = ordinal >> CHUNK_BITS;
+	const auto low = static_cast<uint16_t>(ordinal);
+	if (chunk_index >= chunks_.size())
+	{
+		return;
+	}
+	Chunk &chunk = chunks_[chunk_index];
+
+	if (!chunk.bits.empty())
+	{
+		uint64_t &word = chunk.bits[low / 64];
+		const uint64_t bit = uint64_t{1} << (low % 64);
+		if ((word & bit) != 0)
+		{
+			word &= ~bit;
+			--chunk.size;
+			--size_;
+			if (chunk.size <= BITMAP_LIMIT)
+			{
+				ToArray(chunk);
+			}
+		}
+		return;
+	}
+
+	const auto it = lower_bound(chunk.values.begin(), chunk.values.end(), low);
+	if (it != chunk.values.end() && *it == low)
+	{
+		chunk.values.erase(it);
+		--chunk.size;
+		--size_;
+	}
+}
+
+bool CompressedBitmap::Contains(DocumentOrdinal ordinal) const
+{
+	const size_t chunk_index = ordinal >> CHUNK_BITS;
+	if (chunk_index >= chunks_.size())
+	{
+		return false;
+	}
+	const Chunk &chunk = chunks_[chunk_index];
+	const auto low = static_cast<uint16_t>(ordinal);
+	if (!chunk.bits.empty())
+	{
+		return (chunk.bits[low / 64] >> (low % 64)) & 1;
+	}
+	return binary_search(chunk.values.begin(), chunk.values.end(), low);
+}
+
+size_t CompressedBitmap::size() const
+{
+	return size_;
+}
+
+size_t CompressedBitmap::GetMemoryUsage() const
+{
+	size_t bytes = chunks_.capacity() * sizeof(Chunk);
+	for (const Chunk &chunk : chunks_)
+	{
+		bytes += chunk.values.capacity() * sizeof(uint16_t) + chunk.bits.capacity() * sizeof(uint64_t);
+	}
+	return bytes;
+}
+
+void CompressedBitmap::ToBitmap(Chunk &chunk)
+{
+	chunk.bits.assign(BITMAP_WORDS, 0);
+	for (const uint16_t low : chunk.values)
+	{
+		chunk.bits[low / 64] |= uint64_t{1} << (low % 64);
+	}
+	chunk.values.clear();
+	chunk.values.shrink_to_fit();
+}
+
+void CompressedBitmap::ToArray(Chunk &chunk)
+{
+	chunk.values.reserve(chunk.size);
+	for (size_t low = 0; low < BITMAP_WORDS * 64; ++low)
+	{
+		if ((chunk.bits[low / 64] >> (low % 64)) & 1)
+		{
+			chunk.values.push_back(static_cast<uint16_t>(low));
+		}
+	}
+	chunk.bits.clear();
+	chunk.bits.shrink_to_fit();
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "posting_list.h"
+
+// Roaring-style set of document ordinals. The ordinal space is split into chunks of
+// 65536; a chunk keeps its low 16 bits in a sorted array while it is sparse and
+// switches to a plain 8 KB bitmap once it holds more than 4096 ordinals, so neither
+// form ever takes more than 8 KB. A bitmap turns back into an array only when it drops
+// to 2048 ordinals, so adds and removes around the limit do not convert it every time.
+// Chunks are indexed directly by the high bits, which suits the dense ordinals of the index.
+class CompressedBitmap
+{
+public:
+	void Add(DocumentOrdinal ordinal);
+	void Remove(DocumentOrdinal ordinal);
+	[[nodiscard]] bool Contains(DocumentOrdinal ordinal) const;
+
+	[[nodiscard]] size_t size() const;
+	[[nodiscard]] size_t GetMemoryUsage() const;
+
+private:
+	static constexpr size_t CHUNK_BITS = 16;
+	static constexpr size_t BITMAP_WORDS = (size_t{1} << CHUNK_BITS) / 64;
+	static constexpr size_t ARRAY_LIMIT = 4096;
+	static constexpr size_t BITMAP_LIMIT = ARRAY_LIMIT / 2;
+
+	struct Chunk
+	{
+		// exactly one of them is used: bits once the chunk is dense, values otherwise
+		std::vector<uint16_t> values;
+		std::vector<uint64_t> bits;
+		uint32_t size = 0;
+	};
+
+	static void ToBitmap(Chunk &chunk);
+	static void ToArray(Chunk &chunk);
+
+	std::vector<Chunk> chunks_;
+	size_t size_ = 0;
+};
@@ -1,62 +1,383 @@
 #pragma once
 
-#include <cstdlib>
-#include <map>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <mutex>
-#include <string>
-#include <vector>
+#include <optional>
+#include <shared_mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
 
-#include "log_duration.h"
-#include "test_framework.h"
-
-using namespace std::string_literals;
-
-template <typename Key, typename Value>
+// Hash map for concurrent use, split into stripes. Every stripe is an
+// open-addressing table (linear probing, backward-shift erase) guarded by its
+// own reader/writer lock, so lookups of different threads never block each other.
+// Arithmetic values are stored as atomics: Add updates an existing key under the
+// shared lock with an atomic fetch_add and takes the exclusive lock only to insert.
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
 class ConcurrentMap
 {
 private:
-    struct Bucket
+    using Cell = std::conditional_t<std::is_arithmetic_v<Value>, std::atomic<Value>, Value>;
+
+    struct Slot
     {
-        std::mutex mutex;
-        std::map<Key, Value> map;
+        std::optional<Key> key;
+        Cell value{};
     };
 
-public:
-    static_assert(std::is_integral_v<Key>, "ConcurrentMap supports only integer keys"s);
+    struct Stripe
+    {
+        mutable std::shared_mutex mutex;
+        std::unique_ptr<Slot[]> slots;
+        size_t capacity = 0;
+        size_t size = 0;
+    };
 
-    struct Access
+public:
+    // Reference to the atomic cell of an arithmetic value that reads and updates it like
+    // the value itself, so map[key].ref_to_value += x stays atomic against concurrent Add
+    class AtomicRef
     {
-        std::lock_guard<std::mutex> guard;
-        Value &ref_to_value;
+    public:
+        explicit AtomicRef(std::atomic<Value> &cell)
+            : cell_(cell)
+        {
+        }
+
+        operator Value() const
+        {
+            return cell_.load(std::memory_order_relaxed);
+        }
+
+        AtomicRef &operator=(Value value)
+        {
+            cell_.store(value, std::memory_order_relaxed);
+            return *this;
+        }
 
-        Access(const Key &key, Bucket &bucket)
-            : guard(bucket.mutex), ref_to_value(bucket.map[key])
+        AtomicRef &operator+=(Value delta)
         {
+            AtomicAdd(cell_, delta);
+            return *this;
         }
+
+        AtomicRef &operator-=(Value delta)
+        {
+            AtomicSubtract(cell_, delta);
+            return *this;
+        }
+
+    private:
+        std::atomic<Value> &cell_;
+    };
+
+    using ValueRef = std::conditional_t<std::is_arithmetic_v<Value>, AtomicRef, Value &>;
+
+    // Holds the stripe exclusively while the value is being accessed
+    struct Access
+    {
+        std::unique_lock<std::shared_mutex> guard;
+        ValueRef ref_to_value;
     };
 
-    explicit ConcurrentMap(size_t bucket_count)
-        : buckets_(bucket_count)
+    explicit ConcurrentMap(size_t stripe_count = 4 * std::max(1u, std::thread::hardware_concurrency()))
+        : stripe_count_(std::max<size_t>(stripe_count, 1)), stripes_(std::make_unique<Stripe[]>(stripe_count_))
     {
     }
 
     Access operator[](const Key &key)
     {
-        auto &bucket = buckets_[static_cast<uint64_t>(key) % buckets_.size()];
-        return {key, bucket};
+        const uint64_t hash = HashOf(key);
+        Stripe &stripe = StripeOf(hash);
+        std::unique_lock guard(stripe.mutex);
+        Slot &slot = FindOrInsert(stripe, key, hash);
+        return {std::move(guard), ValueRef(slot.value)};
+    }
+
+    // Adds delta to the value of key, inserting a zero value first if needed
+    void Add(const Key &key, Value delta)
+    {
+        static_assert(std::is_arithmetic_v<Value>, "ConcurrentMap::Add requires an arithmetic value");
+        const uint64_t hash = HashOf(key);
+        Stripe &stripe = StripeOf(hash);
+        {
+            std::shared_lock guard(stripe.mutex);
+            if (Slot *slot = FindSlot(stripe, key, hash))
+            {
+                AtomicAdd(slot->value, delta);
+                return;
+            }
+        }
+        std::unique_lock guard(stripe.mutex);
+        AtomicAdd(FindOrInsert(stripe, key, hash).value, delta);
     }
 
-    std::map<Key, Value> BuildOrdinaryMap()
+    [[nodiscard]] std::optional<Value> Find(const Key &key) const
     {
-        std::map<Key, Value> result;
-        for (auto &[mutex, map] : buckets_)
+        const uint64_t hash = HashOf(key);
+        const Stripe &stripe = StripeOf(hash);
+        std::shared_lock guard(stripe.mutex);
+        if (const Slot *slot = FindSlot(stripe, key, hash))
         {
-            std::lock_guard g(mutex);
-            result.insert(map.begin(), map.end());
+            return Load(slot->value);
+        }
+        return std::nullopt;
+    }
+
+    bool Erase(const Key &key)
+    {
+        const uint64_t hash = HashOf(key);
+        Stripe &stripe = StripeOf(hash);
+        std::unique_lock guard(stripe.mutex);
+        Slot *slot = FindSlot(stripe, key, hash);
+        if (slot == nullptr)
+        {
+            return false;
+        }
+        EraseSlot(stripe, static_cast<size_t>(slot - stripe.slots.get()));
+        return true;
+    }
+
+    [[nodiscard]] size_t size() const
+    {
+        size_t result = 0;
+        for (size_t i = 0; i < stripe_count_; ++i)
+        {
+            std::shared_lock guard(stripes_[i].mutex);
+            result += stripes_[i].size;
         }
         return result;
     }
 
+    // Visits every entry in place as func(const Key &, const Value &), one stripe at a time
+    template <typename Func>
+    void ForEach(Func &&func) const
+    {
+        for (size_t i = 0; i < stripe_count_; ++i)
+        {
+            const Stripe &stripe = stripes_[i];
+            std::shared_lock guard(stripe.mutex);
+            for (size_t pos = 0; pos < stripe.capacity; ++pos)
+            {
+                const Slot &slot = stripe.slots[pos];
+                if (slot.key)
+                {
+                    func(*slot.key, Load(slot.value));
+                }
+            }
+        }
+    }
+
+    // Moves every entry out as func(Key &&, Value &&) and leaves the map empty.
+    // Stripes keep their tables, so a drained map is refilled without allocations.
+    template <typename Func>
+    void Drain(Func &&func)
+    {
+        for (size_t i = 0; i < stripe_count_; ++i)
+        {
+            Stripe &stripe = stripes_[i];
+            std::unique_lock guard(stripe.mutex);
+            for (size_t pos = 0; pos < stripe.capacity; ++pos)
+            {
+                Slot &slot = stripe.slots[pos];
+                if (slot.key)
+                {
+                    func(std::move(*slot.key), TakeValue(slot.value));
+                    slot.key.reset();
+                }
+            }
+            stripe.size = 0;
+        }
+    }
+
 private:
-    std::vector<Bucket> buckets_;
-};
\ No newline at end of file
+    static constexpr size_t INITIAL_CAPACITY = 8;
+
+    size_t stripe_count_;
+    std::unique_ptr<Stripe[]> stripes_;
+
+    static uint64_t HashOf(const Key &key)
+    {
+        // std::hash is the identity for integers, so mix the bits before taking them apart
+        uint64_t hash = static_cast<uint64_t>(Hash{}(key));
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ULL;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    Stripe &StripeOf(uint64_t hash)
+    {
+        return stripes_[hash % stripe_count_];
+    }
+
+    const Stripe &StripeOf(uint64_t hash) const
+    {
+        return stripes_[hash % stripe_count_];
+    }
+
+    size_t HomeOf(const Stripe &stripe, uint64_t hash) const
+    {
+        return static_cast<size_t>(hash / stripe_count_) & (stripe.capacity - 1);
+    }
+
+    Slot *FindSlot(const Stripe &stripe, const Key &key, uint64_t hash) const
+    {
+        if (stripe.capacity == 0)
+        {
+            return nullptr;
+        }
+        for (size_t pos = HomeOf(stripe, hash);; pos = (pos + 1) & (stripe.capacity - 1))
+        {
+            Slot &slot = stripe.slots[pos];
+            if (!slot.key)
+            {
+                return nullptr;
+            }
+            if (KeyEqual{}(*slot.key, key))
+            {
+                return &slot;
+            }
+        }
+    }
+
+    Slot &FindOrInsert(Stripe &stripe, const Key &key, uint64_t hash)
+    {
+        if (Slot *slot = FindSlot(stripe, key, hash))
+        {
+            return *slot;
+        }
+        // keep the load factor below 3/4, so probe sequences stay short
+        if ((stripe.size + 1) * 4 > stripe.capacity * 3)
+        {
+            Grow(stripe);
+        }
+        size_t pos = HomeOf(stripe, hash);
+        while (stripe.slots[pos].key)
+        {
+            pos = (pos + 1) & (stripe.capacity - 1);
+        }
+        Slot &slot = stripe.slots[pos];
+        slot.key.emplace(key);
+        StoreValue(slot.value, Value{});
+        ++stripe.size;
+        return slot;
+    }
+
+    void Grow(Stripe &stripe)
+    {
+        const size_t old_capacity = stripe.capacity;
+        std::unique_ptr<Slot[]> old_slots = std::move(stripe.slots);
+
+        stripe.capacity = old_capacity == 0 ? INITIAL_CAPACITY : old_capacity * 2;
+        stripe.slots = std::make_unique<Slot[]>(stripe.capacity);
+        for (size_t i = 0; i < old_capacity; ++i)
+        {
+            Slot &old_slot = old_slots[i];
+            if (!old_slot.key)
+            {
+                continue;
+            }
+            size_t pos = HomeOf(stripe, HashOf(*old_slot.key));
+            while (stripe.slots[pos].key)
+            {
+                pos = (pos + 1) & (stripe.capacity - 1);
+            }
+            stripe.slots[pos].key = std::move(old_slot.key);
+            StoreValue(stripe.slots[pos].value, TakeValue(old_slot.value));
+        }
+    }
+
+    // Backward-shift deletion: pulls later entries of the probe run into the hole,
+    // so lookups never need tombstones
+    void EraseSlot(Stripe &stripe, size_t hole)
+    {
+        const size_t mask = stripe.capacity - 1;
+        for (size_t pos = (hole + 1) & mask; stripe.slots[pos].key; pos = (pos + 1) & mask)
+        {
+            const size_t home = HomeOf(stripe, HashOf(*stripe.slots[pos].key));
+            // the entry may move to the hole only if the hole lies between its home and its position
+            if (((pos - home) & mask) >= ((pos - hole) & mask))
+            {
+                stripe.slots[hole].key = std::move(stripe.slots[pos].key);
+                StoreValue(stripe.slots[hole].value, TakeValue(stripe.slots[pos].value));
+                hole = pos;
+            }
+        }
+        stripe.slots[hole].key.reset();
+        StoreValue(stripe.slots[hole].value, Value{});
+        --stripe.size;
+    }
+
+    static void AtomicAdd(Cell &cell, Value delta)
+    {
+        if constexpr (std::is_integral_v<Value>)
+        {
+            cell.fetch_add(delta, std::memory_order_relaxed);
+        }
+        else
+        {
+            Value expected = cell.load(std::memory_order_relaxed);
+            while (!cell.compare_exchange_weak(expected, expected + delta, std::memory_order_relaxed))
+            {
+            }
+        }
+    }
+
+    static void AtomicSubtract(Cell &cell, Value delta)
+    {
+        if constexpr (std::is_integral_v<Value>)
+        {
+            cell.fetch_sub(delta, std::memory_order_relaxed);
+        }
+        else
+        {
+            Value expected = cell.load(std::memory_order_relaxed);
+            while (!cell.compare_exchange_weak(expected, expected - delta, std::memory_order_relaxed))
+            {
+            }
+        }
+    }
+
+    static decltype(auto) Load(const Cell &cell)
+    {
+        if constexpr (std::is_arithmetic_v<Value>)
+        {
+            return cell.load(std::memory_order_relaxed);
+        }
+        else
+        {
+            return static_cast<const Value &>(cell);
+        }
+    }
+
+    static Value TakeValue(Cell &cell)
+    {
+        if constexpr (std::is_arithmetic_v<Value>)
+        {
+            return cell.load(std::memory_order_relaxed);
+        }
+        else
+        {
+            return std::move(cell);
+        }
+    }
+
+    static void StoreValue(Cell &cell, Value value)
+    {
+        if constexpr (std::is_arithmetic_v<Value>)
+        {
+            cell.store(value, std::memory_order_relaxed);
+        }
+        else
+        {
+            cell = std::move(value);
+        }
+    }
+};
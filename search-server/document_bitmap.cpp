@@ -0,0 +1,8 @@
+#include "document_bitmap.h"
+
+using namespace std;
+
+void DocumentBitmap::Reset(size_t document_count)
+{
+	words_.assign((document_count + 63) / 64, 0);
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "posting_list.h"
+
+// Dense bitmap over document ordinals, one bit per document
+class DocumentBitmap
+{
+public:
+	// Clears every bit and makes room for ordinals [0, document_count)
+	void Reset(size_t document_count);
+
+	void Set(DocumentOrdinal ordinal)
+	{
+		words_[ordinal / 64] |= uint64_t{1} << (ordinal % 64);
+	}
+
+	[[nodiscard]] bool Test(DocumentOrdinal ordinal) const
+	{
+		return (words_[ordinal / 64] >> (ordinal % 64)) & 1;
+	}
+
+private:
+	std::vector<uint64_t> words_;
+};
@@ -0,0 +1,61 @@
+#include "idf_cache.h"
+
+#include <cmath>
+
+using namespace std;
+
+IdfCache::IdfCache(const IdfCache &other)
+{
+	Resize(other.log_document_freqs_.size());
+}
+
+IdfCache &IdfCache::operator=(const IdfCache &other)
+{
+	if (this != &other)
+	{
+		log_document_freqs_.clear();
+		Resize(other.log_document_freqs_.size());
+		InvalidateDocumentCount();
+	}
+	return *this;
+}
+
+void IdfCache::Resize(size_t term_count)
+{
+	while (log_document_freqs_.size() < term_count)
+	{
+		log_document_freqs_.emplace_back();
+	}
+}
+
+void IdfCache::InvalidateDocumentCount()
+{
+	log_document_count_.valid.store(false, memory_order_relaxed);
+}
+
+void IdfCache::InvalidateTerm(TermId term_id)
+{
+	log_document_freqs_[term_id].valid.store(false, memory_order_relaxed);
+}
+
+double IdfCache::Get(TermId term_id, int document_count, size_t document_freq) const
+{
+	const double log_document_count = GetOrCompute(log_document_count_, [document_count]
+												   { return log(static_cast<double>(document_count)); });
+	const double log_document_freq = GetOrCompute(log_document_freqs_[term_id], [document_freq]
+												  { return log(static_cast<double>(document_freq)); });
+	return log_document_count - log_document_freq;
+}
+
+template <typename Compute>
+double IdfCache::GetOrCompute(Entry &entry, Compute compute)
+{
+	if (entry.valid.load(memory_order_acquire))
+	{
+		return entry.value.load(memory_order_relaxed);
+	}
+	const double value = compute();
+	entry.value.store(value, memory_order_relaxed);
+	entry.valid.store(true, memory_order_release);
+	return value;
+}
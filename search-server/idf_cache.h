@@ -0,0 +1,40 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include "term_dictionary.h"
+
+// Cache of inverse document frequencies, idf = log(N) - log(df).
+// Both logarithms are computed lazily on the first query after they went stale:
+// log(N) is shared by all terms and is dropped on every index mutation, log(df)
+// is dropped per term only when a mutation changes that term's postings.
+// Concurrent queries may fill the same entry, they always store the same value.
+class IdfCache
+{
+public:
+	IdfCache() = default;
+	// a copy starts cold, the values are recomputed on demand
+	IdfCache(const IdfCache &other);
+	IdfCache &operator=(const IdfCache &other);
+
+	void Resize(size_t term_count);
+
+	void InvalidateDocumentCount();
+	void InvalidateTerm(TermId term_id);
+
+	[[nodiscard]] double Get(TermId term_id, int document_count, size_t document_freq) const;
+
+private:
+	struct Entry
+	{
+		std::atomic<bool> valid{false};
+		std::atomic<double> value{0.0};
+	};
+
+	mutable Entry log_document_count_;
+	// deque never relocates entries, std::atomic is neither copyable nor movable
+	mutable std::deque<Entry> log_document_freqs_;
+
+	template <typename Compute>
+	static double GetOrCompute(Entry &entry, Compute compute);
+};
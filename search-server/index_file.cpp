@@ -0,0 +1,228 @@
+#include "index_file.h"
+#include "posting_list.h"
+
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SEARCH_SERVER_HAS_MMAP 1
+#endif
+
+using namespace std;
+
+static_assert(sizeof(Posting) == 8, "Posting is stored in index files as is");
+static_assert(sizeof(PostingBlock) == 16, "PostingBlock is stored in index files as is");
+
+MappedFile::MappedFile(const string &path)
+{
+#ifdef SEARCH_SERVER_HAS_MMAP
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		throw runtime_error("Cannot open index file "s + path);
+	}
+	struct stat file_stat
+	{
+	};
+	if (fstat(fd, &file_stat) != 0)
+	{
+		close(fd);
+		throw runtime_error("Cannot read index file "s + path);
+	}
+	size_ = static_cast<size_t>(file_stat.st_size);
+	if (size_ > 0)
+	{
+		void *mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapping == MAP_FAILED)
+		{
+			close(fd);
+			throw runtime_error("Cannot map index file "s + path);
+		}
+		data_ = static_cast<const char *>(mapping);
+	}
+	close(fd);
+#else
+	ifstream input(path, ios::binary | ios::ate);
+	if (!input)
+	{
+		throw runtime_error("Cannot open index file "s + path);
+	}
+	buffer_.resize(static_cast<size_t>(input.tellg()));
+	input.seekg(0);
+	if (!input.read(buffer_.data(), static_cast<streamsize>(buffer_.size())))
+	{
+		throw runtime_error("Cannot read index file "s + path);
+	}
+	data_ = buffer_.data();
+	size_ = buffer_.size();
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef SEARCH_SERVER_HAS_MMAP
+	if (data_ != nullptr)
+	{
+		munmap(const_cast<char *>(data_), size_);
+	}
+#endif
+}
+
+const char *MappedFile::data() const
+{
+	return data_;
+}
+
+size_t MappedFile::size() const
+{
+	return size_;
+}
+
+namespace
+{
+	void CheckSection(const IndexFileHeader &header, uint64_t offset, uint64_t count, uint64_t item_size)
+	{
+		if (offset % 8 != 0 || offset < sizeof(IndexFileHeader) || offset > header.file_size || count > (header.file_size - offset) / item_size)
+		{
+			throw runtime_error("Index file is corrupted"s);
+		}
+	}
+
+	void CheckOffsets(const MappedFile &file, uint64_t offset, uint64_t count, uint64_t target_size)
+	{
+		const uint64_t *offsets = GetIndexFileSection<uint64_t>(file, offset);
+		if (offsets[0] != 0 || offsets[count] != target_size)
+		{
+			throw runtime_error("Index file is corrupted"s);
+		}
+		for (uint64_t i = 0; i < count; ++i)
+		{
+			if (offsets[i] > offsets[i + 1])
+			{
+				throw runtime_error("Index file is corrupted"s);
+			}
+		}
+	}
+}
+
+const IndexFileHeader &ReadIndexFileHeader(const MappedFile &file)
+{
+	if (file.size() < sizeof(IndexFileHeader))
+	{
+		throw runtime_error("Not an index file"s);
+	}
+	const auto &header = *GetIndexFileSection<IndexFileHeader>(file, 0);
+	if (memcmp(header.magic, INDEX_FILE_MAGIC, sizeof(INDEX_FILE_MAGIC)) != 0)
+	{
+		throw runtime_error("Not an index file"s);
+	}
+	if (header.version != INDEX_FILE_VERSION || header.byte_order != INDEX_FILE_BYTE_ORDER)
+	{
+		throw runtime_error("Unsupported index file version"s);
+	}
+	if (header.file_size != file.size())
+	{
+		throw runtime_error("Index file is truncated"s);
+	}
+	// the term table is probed with a mask and needs an empty slot to end every probe
+	if ((header.term_table_size & (header.term_table_size - 1)) != 0 || (header.term_count > 0 && header.term_table_size <= header.term_count))
+	{
+		throw runtime_error("Index file is corrupted"s);
+	}
+	if (header.ordinal_count > numeric_limits<DocumentOrdinal>::max())
+	{
+		throw runtime_error("Index file is corrupted"s);
+	}
+
+	// offset tables end with an extra entry, counts no item of the file could reach would wrap
+	if (header.stop_word_count >= header.file_size || header.term_count >= header.file_size)
+	{
+		throw runtime_error("Index file is corrupted"s);
+	}
+
+	CheckSection(header, header.stop_word_offsets, header.stop_word_count + 1, sizeof(uint64_t));
+	CheckSection(header, header.term_offsets, header.term_count + 1, sizeof(uint64_t));
+	CheckSection(header, header.term_table, header.term_table_size, sizeof(uint32_t));
+	CheckSection(header, header.posting_lists, header.term_count, sizeof(IndexFilePostingList));
+	CheckSection(header, header.posting_blocks, header.posting_block_count, sizeof(PostingBlock));
+	CheckSection(header, header.posting_words, header.posting_word_count, sizeof(uint32_t));
+	CheckSection(header, header.posting_tails, header.posting_tail_count, sizeof(Posting));
+	CheckSection(header, header.ordinals, header.ordinal_count, sizeof(int32_t));
+	CheckSection(header, header.documents, header.document_count, sizeof(IndexFileDocument));
+	CheckSection(header, header.document_terms, header.document_term_count, sizeof(IndexFileTermCount));
+
+	const auto *stop_word_offsets = GetIndexFileSection<uint64_t>(file, header.stop_word_offsets);
+	const auto *term_offsets = GetIndexFileSection<uint64_t>(file, header.term_offsets);
+	CheckSection(header, header.stop_word_chars, stop_word_offsets[header.stop_word_count], 1);
+	CheckSection(header, header.term_chars, term_offsets[header.term_count], 1);
+	CheckOffsets(file, header.stop_word_offsets, header.stop_word_count, stop_word_offsets[header.stop_word_count]);
+	CheckOffsets(file, header.term_offsets, header.term_count, term_offsets[header.term_count]);
+
+	return header;
+}
+
+IndexFileWriter::IndexFileWriter(const string &path)
+	: path_(path), temp_path_(path + ".tmp"s), output_(temp_path_, ios::binary | ios::trunc)
+{
+	if (!output_)
+	{
+		throw runtime_error("Cannot create index file "s + path);
+	}
+	// the header is written last, once all offsets are known
+	const IndexFileHeader placeholder{};
+	Append(&placeholder, sizeof(placeholder));
+}
+
+IndexFileWriter::~IndexFileWriter()
+{
+	if (!finished_)
+	{
+		output_.close();
+		remove(temp_path_.c_str());
+	}
+}
+
+uint64_t IndexFileWriter::Append(const void *data, size_t size)
+{
+	static const char padding[8] = {};
+	if (offset_ % 8 != 0)
+	{
+		const size_t padding_size = 8 - offset_ % 8;
+		output_.write(padding, static_cast<streamsize>(padding_size));
+		offset_ += padding_size;
+	}
+	const uint64_t offset = offset_;
+	output_.write(static_cast<const char *>(data), static_cast<streamsize>(size));
+	offset_ += size;
+	return offset;
+}
+
+void IndexFileWriter::Finish(IndexFileHeader &header)
+{
+	Append(nullptr, 0);
+	memcpy(header.magic, INDEX_FILE_MAGIC, sizeof(INDEX_FILE_MAGIC));
+	header.version = INDEX_FILE_VERSION;
+	header.byte_order = INDEX_FILE_BYTE_ORDER;
+	header.file_size = offset_;
+
+	output_.seekp(0);
+	output_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	output_.close();
+	if (!output_)
+	{
+		throw runtime_error("Cannot write index file "s + path_);
+	}
+	// a server mapping the old file keeps its pages until it is destroyed; where rename
+	// does not replace an existing file, the old one is removed first
+	if (rename(temp_path_.c_str(), path_.c_str()) != 0 && (remove(path_.c_str()) != 0 || rename(temp_path_.c_str(), path_.c_str()) != 0))
+	{
+		throw runtime_error("Cannot write index file "s + path_);
+	}
+	finished_ = true;
+}
@@ -0,0 +1,155 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Layout of an index file written by SearchServer::SaveIndex.
+//
+// The file is a header followed by flat arrays; every section starts at an 8-byte
+// aligned offset recorded in the header, and all numbers use the byte order of the
+// machine that wrote the file. Nothing needs to be deserialized on load: a loaded server reads
+// term texts, the term hash table and compressed posting lists directly from the mapped
+// file. Posting blocks are decoded once to check their ordinals, which index arrays of the
+// server, and after that only by the cursors reading them.
+//
+//   stop_word_offsets  uint64_t[stop_word_count + 1] into stop_word_chars
+//   stop_word_chars    char[]
+//   term_offsets       uint64_t[term_count + 1] into term_chars, indexed by TermId
+//   term_chars         char[]
+//   term_table         uint32_t[term_table_size], TermId + 1 or 0 for an empty slot,
+//                      linear probing from TermDictionary::Hash
+//   posting_lists      IndexFilePostingList[term_count], indexed by TermId
+//   posting_blocks     PostingBlock[posting_block_count]
+//   posting_words      uint32_t[posting_word_count], bit-packed blocks
+//   posting_tails      Posting[posting_tail_count], postings after the last full block
+//   ordinals           int32_t[ordinal_count], document id of every ordinal
+//   documents          IndexFileDocument[document_count]
+//   document_terms     IndexFileTermCount[document_term_count]
+constexpr char INDEX_FILE_MAGIC[8] = {'S', 'R', 'C', 'H', 'I', 'D', 'X', '\0'};
+constexpr uint32_t INDEX_FILE_VERSION = 2;
+constexpr uint32_t INDEX_FILE_BYTE_ORDER = 0x01020304;
+
+struct IndexFileHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+
+	uint64_t stop_word_count;
+	uint64_t term_count;
+	uint64_t term_table_size;
+	uint64_t posting_block_count;
+	uint64_t posting_word_count;
+	uint64_t posting_tail_count;
+	uint64_t ordinal_count;
+	uint64_t document_count;
+	uint64_t document_term_count;
+
+	uint64_t stop_word_offsets;
+	uint64_t stop_word_chars;
+	uint64_t term_offsets;
+	uint64_t term_chars;
+	uint64_t term_table;
+	uint64_t posting_lists;
+	uint64_t posting_blocks;
+	uint64_t posting_words;
+	uint64_t posting_tails;
+	uint64_t ordinals;
+	uint64_t documents;
+	uint64_t document_terms;
+	uint64_t file_size;
+};
+
+struct IndexFileDocument
+{
+	int32_t id;
+	int32_t rating;
+	uint32_t status;
+	uint32_t ordinal;
+	// terms of the document are document_terms[first_term, first_term + term_count)
+	uint64_t first_term;
+	uint64_t term_count;
+	uint32_t word_count;
+	uint32_t reserved;
+};
+
+struct IndexFileTermCount
+{
+	uint32_t term_id;
+	uint32_t count;
+};
+
+// Compressed postings of a term, the parts of a PostingList laid out in the posting
+// sections; data offsets of its blocks are relative to first_word
+struct IndexFilePostingList
+{
+	uint64_t first_block;
+	uint64_t first_word;
+	uint64_t first_tail_posting;
+	uint32_t block_count;
+	uint32_t tail_size;
+	uint64_t word_count;
+	double max_term_freq;
+};
+
+// Read-only view of a whole file: memory-mapped where the platform allows it,
+// read into memory otherwise
+class MappedFile
+{
+public:
+	explicit MappedFile(const std::string &path);
+	~MappedFile();
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	[[nodiscard]] const char *data() const;
+	[[nodiscard]] size_t size() const;
+
+private:
+	const char *data_ = nullptr;
+	size_t size_ = 0;
+	std::vector<char> buffer_;
+};
+
+// Checks that the file is an index of a supported version whose sections lie
+// inside the file, and returns its header
+const IndexFileHeader &ReadIndexFileHeader(const MappedFile &file);
+
+template <typename T>
+const T *GetIndexFileSection(const MappedFile &file, uint64_t offset)
+{
+	return reinterpret_cast<const T *>(file.data() + offset);
+}
+
+// Writes the sections of an index file one after another, each aligned to 8 bytes.
+// They go to a temporary file next to path that Finish renames over it, so the file a
+// loaded server maps is replaced rather than overwritten and a failed save leaves it as it was.
+class IndexFileWriter
+{
+public:
+	explicit IndexFileWriter(const std::string &path);
+	IndexFileWriter(const IndexFileWriter &) = delete;
+	IndexFileWriter &operator=(const IndexFileWriter &) = delete;
+	// Removes the temporary file unless Finish succeeded
+	~IndexFileWriter();
+
+	// Returns the offset the data was written at
+	uint64_t Append(const void *data, size_t size);
+	template <typename T>
+	uint64_t Append(const std::vector<T> &items)
+	{
+		return Append(items.data(), items.size() * sizeof(T));
+	}
+
+	void Finish(IndexFileHeader &header);
+
+private:
+	std::string path_;
+	std::string temp_path_;
+	std::ofstream output_;
+	uint64_t offset_ = 0;
+	bool finished_ = false;
+};
@@ -1,9 +1,13 @@
 #include "search_server.h"
 #include "process_queries.h"
+#include "bucketed_concurrent_map.h"
 #include "log_duration.h"
 
+#include <cmath>
 #include <execution>
 #include <iostream>
+#include <map>
+#include <numeric>
 #include <random>
 #include <string>
 #include <vector>
@@ -80,6 +84,81 @@ void Test(string_view mark, const SearchServer &search_server, const vector<stri
 
 #define TEST(policy) Test(#policy, search_server, queries, execution::policy)
 
+// Postings of every word as (document_id, term_freq), read back from search_server
+using WordPostings = map<string_view, vector<pair<int, double>>, less<>>;
+
+WordPostings BuildWordPostings(const SearchServer &search_server, int document_count)
+{
+    WordPostings word_postings;
+    for (int document_id = 0; document_id < document_count; ++document_id)
+    {
+        for (const auto &[word, term_freq] : search_server.GetWordFrequencies(document_id))
+        {
+            word_postings[word].push_back({document_id, term_freq});
+        }
+    }
+    return word_postings;
+}
+
+// Status and average rating of every document, as the server computed them before it
+// kept them in ordinal columns
+struct DocumentRecord
+{
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    int rating = 0;
+};
+
+// The parallel FindAllDocuments of the baseline: every posting of every plus word looks its
+// document up for the status check and is added through a BucketedConcurrentMap with 100
+// mutex-guarded std::map buckets; the relevances are then copied into an ordinary map and
+// rated by another lookup. The generated queries have no minus words and stop words have
+// no postings.
+void TestLockedPar(string_view mark, const WordPostings &word_postings, const map<int, DocumentRecord> &documents, const vector<string> &queries)
+{
+    LOG_DURATION(mark);
+    const double document_count = static_cast<double>(documents.size());
+    double total_relevance = 0;
+    for (const string_view query : queries)
+    {
+        vector<string_view> words = SplitIntoWords(query);
+        sort(words.begin(), words.end());
+        words.erase(unique(words.begin(), words.end()), words.end());
+
+        BucketedConcurrentMap<int, double> document_to_relevance(100);
+        for_each(execution::par,
+                 words.begin(), words.end(),
+                 [&](string_view word)
+                 {
+                     const auto postings = word_postings.find(word);
+                     if (postings == word_postings.end())
+                     {
+                         return;
+                     }
+                     const double inverse_document_freq = log(document_count / postings->second.size());
+                     for_each(execution::par,
+                              postings->second.begin(), postings->second.end(),
+                              [&](const pair<int, double> &posting)
+                              {
+                                  if (documents.at(posting.first).status == DocumentStatus::ACTUAL)
+                                  {
+                                      document_to_relevance[posting.first].ref_to_value += posting.second * inverse_document_freq;
+                                  }
+                              });
+                 });
+
+        TopDocuments top_documents(MAX_RESULT_DOCUMENT_COUNT);
+        for (const auto &[document_id, relevance] : document_to_relevance.BuildOrdinaryMap())
+        {
+            top_documents.Add({document_id, relevance, documents.at(document_id).rating});
+        }
+        for (const auto &document : move(top_documents).Extract())
+        {
+            total_relevance += document.relevance;
+        }
+    }
+    cout << total_relevance << endl;
+}
+
 int main()
 {
     mt19937 generator;
@@ -88,14 +167,22 @@ int main()
     const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
 
     SearchServer search_server(dictionary[0]);
+    map<int, DocumentRecord> document_records;
     for (size_t i = 0; i < documents.size(); ++i)
     {
-        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        const vector<int> ratings = {1, 2, 3};
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, ratings);
+        document_records[i] = {DocumentStatus::ACTUAL, accumulate(ratings.begin(), ratings.end(), 0) / static_cast<int>(ratings.size())};
     }
 
     const auto queries = GenerateQueries(generator, dictionary, 100, 70);
 
     TEST(seq);
     TEST(par);
+
+    // before/after of the parallel scoring: the baseline locked path against TEST(par)
+    // above, on the same documents and queries; the total relevances printed must agree
+    const auto word_postings = BuildWordPostings(search_server, static_cast<int>(documents.size()));
+    TestLockedPar("locked par"sv, word_postings, document_records, queries);
     cout << "Ok";
 }
\ No newline at end of file
@@ -0,0 +1,213 @@
+#include "posting_list.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+PostingList::Cursor::Cursor(const PostingList &postings)
+	: postings_(&postings)
+{
+	LoadBlock(0);
+}
+
+void PostingList::Cursor::Seek(DocumentOrdinal document_ordinal)
+{
+	if (IsAtEnd() || ordinals_[offset_] >= document_ordinal)
+	{
+		return;
+	}
+	const size_t block_count = postings_->GetBlockCount();
+	if (ordinals_[block_size_ - 1] < document_ordinal)
+	{
+		if (block_ == block_count)
+		{
+			offset_ = block_size_;
+			return;
+		}
+		// gallops over the skip entries, so stepping through ascending ordinals
+		// costs O(log gap) blocks per step
+		const PostingBlock *blocks = postings_->GetBlocks();
+		size_t low = block_ + 1;
+		size_t high = low;
+		for (size_t step = 1; high < block_count && blocks[high].last_ordinal < document_ordinal; step *= 2)
+		{
+			low = high + 1;
+			high += step;
+		}
+		const auto next_block = partition_point(blocks + low, blocks + min(high, block_count), [document_ordinal](const PostingBlock &block)
+												{ return block.last_ordinal < document_ordinal; });
+		LoadBlock(static_cast<size_t>(next_block - blocks));
+	}
+	offset_ = static_cast<size_t>(lower_bound(ordinals_.begin() + offset_, ordinals_.begin() + block_size_, document_ordinal) - ordinals_.begin());
+}
+
+void PostingList::Cursor::LoadBlock(size_t block)
+{
+	block_ = block;
+	offset_ = 0;
+	if (block == postings_->GetBlockCount())
+	{
+		const Posting *tail = postings_->GetTail();
+		block_size_ = postings_->GetTailSize();
+		for (size_t i = 0; i < block_size_; ++i)
+		{
+			ordinals_[i] = tail[i].document_ordinal;
+			counts_[i] = tail[i].count - 1;
+		}
+		are_counts_loaded_ = true;
+		return;
+	}
+
+	const PostingBlock &entry = postings_->GetBlocks()[block];
+	// the first gap is stored as 0, so the running sums start one below the first ordinal
+	UnpackIncreasingBlock(postings_->GetWords() + entry.data_offset, entry.ordinal_bit_width, entry.first_ordinal - 1, ordinals_.data());
+	block_size_ = POSTING_BLOCK_SIZE;
+	are_counts_loaded_ = false;
+}
+
+void PostingList::Cursor::LoadCounts()
+{
+	const PostingBlock &entry = postings_->GetBlocks()[block_];
+	UnpackBlock(postings_->GetWords() + entry.data_offset + GetPackedWordCount(entry.ordinal_bit_width), entry.count_bit_width, counts_.data());
+	are_counts_loaded_ = true;
+}
+
+PostingList PostingList::View(const PostingBlock *blocks, size_t block_count, const uint32_t *words, size_t word_count, const Posting *tail, size_t tail_size)
+{
+	PostingList result;
+	result.is_view_ = true;
+	result.view_blocks_ = blocks;
+	result.view_block_count_ = block_count;
+	result.view_words_ = words;
+	result.view_word_count_ = word_count;
+	result.view_tail_ = tail;
+	result.view_tail_size_ = tail_size;
+	return result;
+}
+
+void PostingList::Add(DocumentOrdinal document_ordinal, uint32_t count)
+{
+	MakeOwned();
+
+	const bool is_ordered = tail_.empty() ? blocks_.empty() || blocks_.back().last_ordinal < document_ordinal
+										  : tail_.back().document_ordinal < document_ordinal;
+	if (!is_ordered || count == 0)
+	{
+		throw invalid_argument("Postings must be added in ordinal order with a positive count"s);
+	}
+	tail_.push_back({document_ordinal, count});
+	if (tail_.size() == POSTING_BLOCK_SIZE)
+	{
+		PackTail();
+	}
+}
+
+size_t PostingList::size() const
+{
+	return GetBlockCount() * POSTING_BLOCK_SIZE + GetTailSize();
+}
+
+bool PostingList::empty() const
+{
+	return size() == 0;
+}
+
+bool PostingList::AreOrdinalsValid(DocumentOrdinal end_ordinal) const
+{
+	const PostingBlock *blocks = GetBlocks();
+	const size_t block_count = GetBlockCount();
+	bool is_first = true;
+	DocumentOrdinal previous = 0;
+	for (Cursor cursor(*this); !cursor.IsAtEnd(); cursor.Next())
+	{
+		const DocumentOrdinal ordinal = cursor.GetOrdinal();
+		if (ordinal >= end_ordinal || (!is_first && ordinal <= previous))
+		{
+			return false;
+		}
+		const size_t block = cursor.GetPosition() / POSTING_BLOCK_SIZE;
+		const size_t offset = cursor.GetPosition() % POSTING_BLOCK_SIZE;
+		if (block < block_count && ((offset == 0 && ordinal != blocks[block].first_ordinal) ||
+									(offset == POSTING_BLOCK_SIZE - 1 && ordinal != blocks[block].last_ordinal)))
+		{
+			return false;
+		}
+		is_first = false;
+		previous = ordinal;
+	}
+	return true;
+}
+
+size_t PostingList::GetMemoryUsage() const
+{
+	return blocks_.capacity() * sizeof(PostingBlock) + words_.capacity() * sizeof(uint32_t) + tail_.capacity() * sizeof(Posting);
+}
+
+const PostingBlock *PostingList::GetBlocks() const
+{
+	return is_view_ ? view_blocks_ : blocks_.data();
+}
+
+size_t PostingList::GetBlockCount() const
+{
+	return is_view_ ? view_block_count_ : blocks_.size();
+}
+
+const uint32_t *PostingList::GetWords() const
+{
+	return is_view_ ? view_words_ : words_.data();
+}
+
+size_t PostingList::GetWordCount() const
+{
+	return is_view_ ? view_word_count_ : words_.size();
+}
+
+const Posting *PostingList::GetTail() const
+{
+	return is_view_ ? view_tail_ : tail_.data();
+}
+
+size_t PostingList::GetTailSize() const
+{
+	return is_view_ ? view_tail_size_ : tail_.size();
+}
+
+void PostingList::MakeOwned()
+{
+	if (is_view_)
+	{
+		blocks_.assign(view_blocks_, view_blocks_ + view_block_count_);
+		words_.assign(view_words_, view_words_ + view_word_count_);
+		tail_.assign(view_tail_, view_tail_ + view_tail_size_);
+		is_view_ = false;
+	}
+}
+
+void PostingList::PackTail()
+{
+	array<uint32_t, POSTING_BLOCK_SIZE> gaps;
+	array<uint32_t, POSTING_BLOCK_SIZE> counts;
+	gaps[0] = 0;
+	counts[0] = tail_[0].count - 1;
+	uint32_t max_gap = 0;
+	uint32_t max_count = counts[0];
+	for (size_t i = 1; i < POSTING_BLOCK_SIZE; ++i)
+	{
+		gaps[i] = tail_[i].document_ordinal - tail_[i - 1].document_ordinal - 1;
+		counts[i] = tail_[i].count - 1;
+		max_gap = max(max_gap, gaps[i]);
+		max_count = max(max_count, counts[i]);
+	}
+
+	PostingBlock block{tail_.front().document_ordinal, tail_.back().document_ordinal, static_cast<uint32_t>(words_.size()),
+					   static_cast<uint8_t>(GetBitWidth(max_gap)), static_cast<uint8_t>(GetBitWidth(max_count)), 0};
+	const size_t gap_word_count = GetPackedWordCount(block.ordinal_bit_width);
+	words_.resize(words_.size() + gap_word_count + GetPackedWordCount(block.count_bit_width));
+	PackBlock(gaps.data(), block.ordinal_bit_width, words_.data() + block.data_offset);
+	PackBlock(counts.data(), block.count_bit_width, words_.data() + block.data_offset + gap_word_count);
+	blocks_.push_back(block);
+	tail_.clear();
+}
@@ -0,0 +1,157 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "bit_packing.h"
+
+// Internal dense number of a document, assigned in insertion order
+using DocumentOrdinal = uint32_t;
+
+// A document containing a term and how many times it does
+struct Posting
+{
+	DocumentOrdinal document_ordinal;
+	uint32_t count;
+};
+
+const size_t POSTING_BLOCK_SIZE = BIT_PACKING_BLOCK_SIZE;
+
+// Skip entry of a full block of postings. The block stores ordinal gaps less one and
+// counts less one, bit-packed with the widths below, from words[data_offset] of its list.
+struct PostingBlock
+{
+	DocumentOrdinal first_ordinal;
+	DocumentOrdinal last_ordinal;
+	uint32_t data_offset;
+	uint8_t ordinal_bit_width;
+	uint8_t count_bit_width;
+	uint16_t reserved;
+};
+
+// Postings of a single term sorted by document_ordinal, compressed in blocks of
+// POSTING_BLOCK_SIZE; the postings after the last full block are kept as they are until
+// the block fills. The arrays are either owned or read-only views into a loaded index file;
+// a view is copied into owned storage on its first modification.
+class PostingList
+{
+public:
+	// Reads the postings in ordinal order, decoding one block at a time
+	class Cursor
+	{
+	public:
+		explicit Cursor(const PostingList &postings);
+
+		[[nodiscard]] bool IsAtEnd() const
+		{
+			return offset_ >= block_size_;
+		}
+		[[nodiscard]] DocumentOrdinal GetOrdinal() const
+		{
+			return ordinals_[offset_];
+		}
+		[[nodiscard]] uint32_t GetCount()
+		{
+			if (!are_counts_loaded_)
+			{
+				LoadCounts();
+			}
+			return counts_[offset_] + 1;
+		}
+		// Index of the current posting in the list, size() at the end
+		[[nodiscard]] size_t GetPosition() const
+		{
+			return block_ * POSTING_BLOCK_SIZE + offset_;
+		}
+
+		void Next()
+		{
+			if (++offset_ == block_size_ && block_ < postings_->GetBlockCount())
+			{
+				LoadBlock(block_ + 1);
+			}
+		}
+		// Moves forward to the first posting whose ordinal is not less than document_ordinal.
+		// Blocks that end before it are skipped by their skip entries without being decoded.
+		void Seek(DocumentOrdinal document_ordinal);
+		// Calls func(ordinal, count) for every posting before end_ordinal and moves past them,
+		// looping over the decoded blocks without the checks of Next
+		template <typename Func>
+		void ForEachBefore(DocumentOrdinal end_ordinal, Func func);
+
+	private:
+		const PostingList *postings_;
+		// the loaded block, GetBlockCount() for the tail
+		size_t block_ = 0;
+		size_t offset_ = 0;
+		size_t block_size_ = 0;
+		std::array<DocumentOrdinal, POSTING_BLOCK_SIZE> ordinals_;
+		// less one, as they are packed; unpacked on first use, since probes seldom need them
+		std::array<uint32_t, POSTING_BLOCK_SIZE> counts_;
+		bool are_counts_loaded_ = false;
+
+		void LoadBlock(size_t block);
+		void LoadCounts();
+	};
+
+	PostingList() = default;
+	static PostingList View(const PostingBlock *blocks, size_t block_count, const uint32_t *words, size_t word_count, const Posting *tail, size_t tail_size);
+
+	// Ordinals must be added in increasing order, counts must be positive
+	void Add(DocumentOrdinal document_ordinal, uint32_t count);
+
+	[[nodiscard]] size_t size() const;
+	[[nodiscard]] bool empty() const;
+	// Decodes every block and checks that the ordinals increase, stay below end_ordinal and
+	// agree with the skip entries; cursors rely on all of it without checks of their own
+	[[nodiscard]] bool AreOrdinalsValid(DocumentOrdinal end_ordinal) const;
+	// Heap memory owned by the list, a view owns none
+	[[nodiscard]] size_t GetMemoryUsage() const;
+
+	// The compressed arrays, as SearchServer::SaveIndex writes them
+	[[nodiscard]] const PostingBlock *GetBlocks() const;
+	[[nodiscard]] size_t GetBlockCount() const;
+	[[nodiscard]] const uint32_t *GetWords() const;
+	[[nodiscard]] size_t GetWordCount() const;
+	[[nodiscard]] const Posting *GetTail() const;
+	[[nodiscard]] size_t GetTailSize() const;
+
+private:
+	std::vector<PostingBlock> blocks_;
+	std::vector<uint32_t> words_;
+	std::vector<Posting> tail_;
+
+	bool is_view_ = false;
+	const PostingBlock *view_blocks_ = nullptr;
+	size_t view_block_count_ = 0;
+	const uint32_t *view_words_ = nullptr;
+	size_t view_word_count_ = 0;
+	const Posting *view_tail_ = nullptr;
+	size_t view_tail_size_ = 0;
+
+	void MakeOwned();
+	void PackTail();
+};
+
+template <typename Func>
+void PostingList::Cursor::ForEachBefore(DocumentOrdinal end_ordinal, Func func)
+{
+	while (!IsAtEnd())
+	{
+		if (!are_counts_loaded_)
+		{
+			LoadCounts();
+		}
+		size_t offset = offset_;
+		for (; offset < block_size_ && ordinals_[offset] < end_ordinal; ++offset)
+		{
+			func(ordinals_[offset], counts_[offset] + 1);
+		}
+		offset_ = offset;
+		if (offset < block_size_ || block_ == postings_->GetBlockCount())
+		{
+			return;
+		}
+		LoadBlock(block_ + 1);
+	}
+}
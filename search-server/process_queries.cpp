@@ -5,29 +5,81 @@ using namespace std;
 vector<vector<Document>> ProcessQueries(const SearchServer &search_server, const vector<string> &queries)
 {
     vector<vector<Document>> result(queries.size());
-    transform(
-        execution::par,
-        queries.begin(), queries.end(),
-        result.begin(),
-        [&search_server](const string &query)
-        { return search_server.FindTopDocuments(query); });
+    search_server.GetThreadPool().ParallelFor(
+        queries.size(),
+        [&](size_t index)
+        { result[index] = search_server.FindTopDocuments(queries[index]); });
     return result;
 }
 
-list<Document> ProcessQueriesJoined(const SearchServer &search_server, const vector<string> &queries)
+JoinedQueryResults ProcessQueriesJoined(const SearchServer &search_server, const vector<string> &queries, size_t top_count)
 {
-	const vector<vector<Document>> mid_result = ProcessQueries(search_server, queries);
-    int count_mid_result = 0;
-    for (const auto& i : mid_result)
+    // the results are sized by what the queries find, not by top_count, and copied once
+    // into the joined buffer
+    vector<vector<Document>> found(queries.size());
+    ThreadPool &thread_pool = search_server.GetThreadPool();
+    thread_pool.ParallelFor(
+        queries.size(),
+        [&](size_t index)
+        { found[index] = search_server.FindTopDocuments(queries[index], DocumentStatus::ACTUAL, top_count); });
+
+    vector<size_t> offsets(queries.size() + 1, 0);
+    for (size_t index = 0; index < queries.size(); ++index)
     {
-        count_mid_result += static_cast<int>(i.size());
+        offsets[index + 1] = offsets[index] + found[index].size();
     }
-    list<Document> result(count_mid_result);
-    auto iter = result.begin();
-    for (auto i : mid_result)
+    vector<Document> documents(offsets.back());
+    thread_pool.ParallelFor(
+        queries.size(),
+        [&](size_t index)
+        { copy(found[index].begin(), found[index].end(), documents.begin() + static_cast<ptrdiff_t>(offsets[index])); });
+    return {move(documents), move(offsets)};
+}
+
+JoinedQueryResults::JoinedQueryResults(vector<Document> documents, vector<size_t> offsets)
+    : documents_(move(documents)), offsets_(move(offsets))
+{
+    if (offsets_.empty() || offsets_.front() != 0 || offsets_.back() != documents_.size() || !is_sorted(offsets_.begin(), offsets_.end()))
     {
-        move(i.begin(), i.end(), iter);
-        iter = next(iter, static_cast<long long>(i.size()));
+        throw invalid_argument("Invalid query result offsets"s);
     }
-    return result;
-}
\ No newline at end of file
+}
+
+size_t JoinedQueryResults::GetQueryCount() const
+{
+    return offsets_.size() - 1;
+}
+
+IteratorRange<JoinedQueryResults::const_iterator> JoinedQueryResults::GetQueryResults(size_t query_index) const
+{
+    if (query_index >= GetQueryCount())
+    {
+        throw invalid_argument("Invalid query index"s);
+    }
+    return {documents_.begin() + static_cast<ptrdiff_t>(offsets_[query_index]), documents_.begin() + static_cast<ptrdiff_t>(offsets_[query_index + 1])};
+}
+
+const vector<size_t> &JoinedQueryResults::GetOffsets() const
+{
+    return offsets_;
+}
+
+size_t JoinedQueryResults::size() const
+{
+    return documents_.size();
+}
+
+bool JoinedQueryResults::empty() const
+{
+    return documents_.empty();
+}
+
+JoinedQueryResults::const_iterator JoinedQueryResults::begin() const
+{
+    return documents_.begin();
+}
+
+JoinedQueryResults::const_iterator JoinedQueryResults::end() const
+{
+    return documents_.end();
+}
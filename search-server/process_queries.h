@@ -1,9 +1,35 @@
 #pragma once
 #include <vector>
 #include <string>
-#include <list>
+#include "paginator.h"
 #include "search_server.h"
 
+// Results of a batch of queries in one contiguous buffer: the results of query i are
+// the documents [offsets[i], offsets[i + 1]). Iterating the object itself streams the
+// documents of all queries in query order, without copying them.
+class JoinedQueryResults
+{
+public:
+    using const_iterator = std::vector<Document>::const_iterator;
+
+    JoinedQueryResults() = default;
+    JoinedQueryResults(std::vector<Document> documents, std::vector<size_t> offsets);
+
+    [[nodiscard]] size_t GetQueryCount() const;
+    [[nodiscard]] IteratorRange<const_iterator> GetQueryResults(size_t query_index) const;
+    [[nodiscard]] const std::vector<size_t> &GetOffsets() const;
+
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] bool empty() const;
+    const_iterator begin() const;
+    const_iterator end() const;
+
+private:
+    std::vector<Document> documents_;
+    std::vector<size_t> offsets_{0};
+};
+
 std::vector<std::vector<Document>> ProcessQueries(const SearchServer &search_server, const std::vector<std::string> &queries);
 
-std::list<Document> ProcessQueriesJoined(const SearchServer &search_server, const std::vector<std::string> &queries);
\ No newline at end of file
+// Runs FindTopDocuments(query, DocumentStatus::ACTUAL, top_count) for every query in parallel
+JoinedQueryResults ProcessQueriesJoined(const SearchServer &search_server, const std::vector<std::string> &queries, size_t top_count = MAX_RESULT_DOCUMENT_COUNT);
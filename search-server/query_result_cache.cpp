@@ -0,0 +1,120 @@
+#include "query_result_cache.h"
+
+using namespace std;
+
+bool QueryCacheKey::operator==(const QueryCacheKey &other) const
+{
+	return status == other.status && top_count == other.top_count && plus_terms == other.plus_terms && minus_terms == other.minus_terms;
+}
+
+size_t QueryResultCache::KeyHash::operator()(const QueryCacheKey &key) const
+{
+	uint64_t hash = static_cast<uint64_t>(key.status) * 31 + key.top_count;
+	const auto mix = [&hash](uint64_t value)
+	{
+		hash = (hash ^ value) * 0x9e3779b97f4a7c15ULL;
+		hash ^= hash >> 29;
+	};
+	for (const TermId term_id : key.plus_terms)
+	{
+		mix(term_id);
+	}
+	// separates "a -b" from "a b"
+	mix(~uint64_t{0});
+	for (const TermId term_id : key.minus_terms)
+	{
+		mix(term_id);
+	}
+	return static_cast<size_t>(hash);
+}
+
+QueryResultCache::QueryResultCache(const QueryResultCache &other)
+	: capacity_(other.capacity_.load())
+{
+}
+
+QueryResultCache &QueryResultCache::operator=(const QueryResultCache &other)
+{
+	if (this != &other)
+	{
+		lock_guard guard(mutex_);
+		entries_.clear();
+		positions_.clear();
+		capacity_ = other.capacity_.load();
+	}
+	return *this;
+}
+
+void QueryResultCache::SetCapacity(size_t capacity)
+{
+	lock_guard guard(mutex_);
+	capacity_ = capacity;
+	EvictOverflow();
+}
+
+bool QueryResultCache::IsEnabled() const
+{
+	return capacity_ > 0;
+}
+
+optional<vector<Document>> QueryResultCache::Find(const QueryCacheKey &key, uint64_t generation) const
+{
+	lock_guard guard(mutex_);
+	Synchronize(generation);
+
+	const auto it = positions_.find(key);
+	if (it == positions_.end())
+	{
+		++misses_;
+		return nullopt;
+	}
+	++hits_;
+	entries_.splice(entries_.begin(), entries_, it->second);
+	return it->second->documents;
+}
+
+void QueryResultCache::Insert(const QueryCacheKey &key, uint64_t generation, const vector<Document> &documents) const
+{
+	lock_guard guard(mutex_);
+	Synchronize(generation);
+	if (generation != generation_ || capacity_ == 0)
+	{
+		// computed against an older index than the cached entries
+		return;
+	}
+
+	if (const auto it = positions_.find(key); it != positions_.end())
+	{
+		// another thread computed the same query meanwhile
+		entries_.splice(entries_.begin(), entries_, it->second);
+		return;
+	}
+	entries_.push_front({key, documents});
+	positions_.emplace(key, entries_.begin());
+	EvictOverflow();
+}
+
+QueryCacheStats QueryResultCache::GetStats() const
+{
+	lock_guard guard(mutex_);
+	return {hits_, misses_, entries_.size(), capacity_};
+}
+
+void QueryResultCache::Synchronize(uint64_t generation) const
+{
+	if (generation > generation_)
+	{
+		entries_.clear();
+		positions_.clear();
+		generation_ = generation;
+	}
+}
+
+void QueryResultCache::EvictOverflow() const
+{
+	while (entries_.size() > capacity_)
+	{
+		positions_.erase(entries_.back().key);
+		entries_.pop_back();
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "document.h"
+#include "term_dictionary.h"
+
+// Normalized query: sorted unique plus and minus terms, the status and the result size
+struct QueryCacheKey
+{
+	std::vector<TermId> plus_terms;
+	std::vector<TermId> minus_terms;
+	DocumentStatus status = DocumentStatus::ACTUAL;
+	size_t top_count = 0;
+
+	bool operator==(const QueryCacheKey &other) const;
+};
+
+struct QueryCacheStats
+{
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	size_t size = 0;
+	size_t capacity = 0;
+};
+
+// Least recently used cache of FindTopDocuments results. Queries are const, so the
+// cache is filled through const methods; every method is safe for concurrent use.
+// Results are valid for one generation of the index: the first access with a newer
+// generation drops every entry. A capacity of 0 disables the cache.
+class QueryResultCache
+{
+public:
+	QueryResultCache() = default;
+	// a copy has the same capacity and starts empty
+	QueryResultCache(const QueryResultCache &other);
+	QueryResultCache &operator=(const QueryResultCache &other);
+
+	void SetCapacity(size_t capacity);
+	[[nodiscard]] bool IsEnabled() const;
+
+	[[nodiscard]] std::optional<std::vector<Document>> Find(const QueryCacheKey &key, uint64_t generation) const;
+	void Insert(const QueryCacheKey &key, uint64_t generation, const std::vector<Document> &documents) const;
+
+	[[nodiscard]] QueryCacheStats GetStats() const;
+
+private:
+	struct KeyHash
+	{
+		size_t operator()(const QueryCacheKey &key) const;
+	};
+	struct Entry
+	{
+		QueryCacheKey key;
+		std::vector<Document> documents;
+	};
+
+	// drops the entries of older generations, the mutex must be held
+	void Synchronize(uint64_t generation) const;
+	void EvictOverflow() const;
+
+	mutable std::mutex mutex_;
+	std::atomic<size_t> capacity_{0};
+	mutable uint64_t generation_ = 0;
+	// most recently used first
+	mutable std::list<Entry> entries_;
+	mutable std::unordered_map<QueryCacheKey, std::list<Entry>::iterator, KeyHash> positions_;
+
+	mutable uint64_t hits_ = 0;
+	mutable uint64_t misses_ = 0;
+};
@@ -9,7 +9,7 @@ void RemoveDuplicates(SearchServer& search_server)
 		std::set<std::string> words_;
 		for (const auto& [words_from_doc, d] : search_server.GetWordFrequencies(id))
 		{
-			words_.insert(words_from_doc);
+			words_.insert(std::string(words_from_doc));
 		}
 		const int last_item = *(work_base[words_].end());
 		work_base[words_].insert(id);
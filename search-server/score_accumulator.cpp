@@ -0,0 +1,26 @@
+#include "score_accumulator.h"
+
+#include <algorithm>
+
+using namespace std;
+
+void ScoreAccumulator::Reset(size_t document_count)
+{
+	if (generations_.size() < document_count)
+	{
+		generations_.resize(document_count, 0);
+		scores_.resize(document_count);
+	}
+	touched_.clear();
+
+	if (++generation_ == 0)
+	{
+		fill(generations_.begin(), generations_.end(), 0);
+		generation_ = 1;
+	}
+}
+
+const vector<DocumentOrdinal> &ScoreAccumulator::GetTouched() const
+{
+	return touched_;
+}
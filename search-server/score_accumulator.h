@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "posting_list.h"
+
+// Dense relevance accumulator indexed by document ordinal.
+// A slot holds a score only if its generation matches the current query, so Reset
+// does not clear the arrays; the touched list remembers which slots were scored.
+// Excluded documents are filtered out before scoring, see SearchServer::FindExcludedDocuments.
+class ScoreAccumulator
+{
+public:
+	// Starts a new query over ordinals [0, document_count)
+	void Reset(size_t document_count);
+
+	// defined here, so the scoring loops inline the per-posting work
+	void Add(DocumentOrdinal ordinal, double score)
+	{
+		if (generations_[ordinal] != generation_)
+		{
+			generations_[ordinal] = generation_;
+			scores_[ordinal] = 0.0;
+			touched_.push_back(ordinal);
+		}
+		scores_[ordinal] += score;
+	}
+
+	[[nodiscard]] double Get(DocumentOrdinal ordinal) const
+	{
+		return scores_[ordinal];
+	}
+
+	// Ordinals scored since the last Reset
+	[[nodiscard]] const std::vector<DocumentOrdinal> &GetTouched() const;
+
+private:
+	// generation 0 is never current, so fresh slots start out empty
+	uint32_t generation_ = 0;
+	std::vector<uint32_t> generations_;
+	std::vector<double> scores_;
+	std::vector<DocumentOrdinal> touched_;
+};
@@ -2,22 +2,26 @@
 
 using namespace std;
 
+void CollectionStatistics::Add(const CollectionStatistics &other)
+{
+	document_count += other.document_count;
+	for (const auto &[word, document_freq] : other.document_freqs)
+	{
+		document_freqs[word] += document_freq;
+	}
+}
+
 SearchServer::SearchServer()
 = default;
 
 SearchServer::SearchServer(const string &stop_words_text)
-	: SearchServer(SplitIntoWords(stop_words_text))
+	: SearchServer(WordRange(stop_words_text))
 {
 }
 
 SearchServer::SearchServer(const string_view stop_words_text)
-	: SearchServer(SplitIntoWords(stop_words_text))
-{
-}
-
-std::string_view SearchServer::AddUniqueWord(const std::string &word)
+	: SearchServer(WordRange(stop_words_text))
 {
-	return std::string_view(*(unique_words.insert(word).first));
 }
 
 void SearchServer::AddDocument(int document_id, const string_view document, DocumentStatus status, const vector<int> &ratings)
@@ -26,44 +30,230 @@ void SearchServer::AddDocument(int document_id, const string_view document, Docu
 	{
 		throw invalid_argument("Invalid document_id"s);
 	}
+	if (static_cast<size_t>(status) >= STATUS_COUNT)
+	{
+		throw invalid_argument("Invalid document status"s);
+	}
 
+	// the first pass validates and counts the words, so nothing is changed for an invalid document
 	const auto words = SplitIntoWordsNoStop(document);
+	const auto document_ordinal = static_cast<DocumentOrdinal>(ordinal_to_document_id_.size());
 
-	//unordered_set<std::string_view> document_words;
-	set<std::string_view> document_words;
-
-	const double inv_word_count = 1.0 / static_cast<double>(words.size());
+	const auto word_count = static_cast<uint32_t>(distance(words.begin(), words.end()));
+	const double inverse_word_count = 1.0 / static_cast<double>(word_count);
 
+	auto &term_counts = document_to_term_counts_[document_id];
 	for (const auto &word : words)
 	{
-		const string_view current_word = AddUniqueWord(string(word));
-
-		document_to_word_freqs_[document_id][word] += inv_word_count;
-		word_to_document_freqs_[current_word][document_id] += inv_word_count;
+		++term_counts[terms_.Intern(word)];
+	}
+	term_to_document_freqs_.resize(terms_.size());
+	term_document_counts_.resize(terms_.size());
+	term_max_freqs_.resize(terms_.size());
+	idf_cache_.Resize(terms_.size());
 
-		document_words.insert(current_word);
+	vector<TermId> document_terms;
+	document_terms.reserve(term_counts.size());
+	for (const auto &[term_id, count] : term_counts)
+	{
+		term_to_document_freqs_[term_id].Add(document_ordinal, count);
+		++term_document_counts_[term_id];
+		term_max_freqs_[term_id] = max(term_max_freqs_[term_id], ComputeTermFreq(count, inverse_word_count));
+		idf_cache_.InvalidateTerm(term_id);
+		document_terms.push_back(term_id);
 	}
+	idf_cache_.InvalidateDocumentCount();
+
+	AppendDocument(document_id, ComputeAverageRating(ratings), status, word_count, move(document_terms));
+	++generation_;
+}
 
-	documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status, document_words});
+void SearchServer::AppendDocument(int document_id, int rating, DocumentStatus status, uint32_t word_count, vector<TermId> terms)
+{
+	const auto document_ordinal = static_cast<DocumentOrdinal>(ordinal_to_document_id_.size());
+	documents_.emplace(document_id, DocumentData{document_ordinal, move(terms)});
 	document_ids_.emplace(document_id);
+	ordinal_to_document_id_.push_back(document_id);
+	removed_ordinals_.push_back(false);
+	ordinal_ratings_.push_back(rating);
+	ordinal_statuses_.push_back(status);
+	ordinal_word_counts_.push_back(word_count);
+	ordinal_inverse_word_counts_.push_back(1.0 / static_cast<double>(word_count));
+	status_documents_[static_cast<size_t>(status)].Add(document_ordinal);
 }
 
-vector<Document> SearchServer::FindTopDocuments(const string_view raw_query, DocumentStatus status) const
+void SearchServer::AddDocumentBatch(execution::sequenced_policy policy, const vector<const RawDocument *> &documents)
 {
-	return FindTopDocuments(std::execution::seq, raw_query, [status](int document_id, DocumentStatus document_status, int rating)
-	                        { return document_status == status; });
+	CheckNewDocuments(documents);
+
+	vector<PartialIndex> partial_indexes(1);
+	BuildPartialIndex(documents, 0, documents.size(), partial_indexes.front());
+	MergePartialIndexes(documents, partial_indexes);
 }
 
-vector<Document> SearchServer::FindTopDocuments(std::execution::sequenced_policy policy, const string_view raw_query, DocumentStatus status) const
+void SearchServer::AddDocumentBatch(execution::parallel_policy policy, const vector<const RawDocument *> &documents)
 {
-	return FindTopDocuments(std::execution::seq, raw_query, [status](int document_id, DocumentStatus document_status, int rating)
-	                        { return document_status == status; });
+	CheckNewDocuments(documents);
+
+	const size_t chunk_count = max<size_t>(1, min<size_t>(documents.size(), thread::hardware_concurrency()));
+	const size_t chunk_size = (documents.size() + chunk_count - 1) / chunk_count;
+	vector<PartialIndex> partial_indexes(chunk_count);
+
+	vector<size_t> chunk_indexes(chunk_count);
+	iota(chunk_indexes.begin(), chunk_indexes.end(), 0);
+	for_each(execution::par,
+			 chunk_indexes.begin(), chunk_indexes.end(),
+			 [&](size_t chunk)
+			 {
+				 const size_t first = min(chunk * chunk_size, documents.size());
+				 const size_t last = min(first + chunk_size, documents.size());
+				 // an exception escaping a parallel algorithm calls std::terminate
+				 try
+				 {
+					 BuildPartialIndex(documents, first, last, partial_indexes[chunk]);
+				 }
+				 catch (...)
+				 {
+					 partial_indexes[chunk].error = current_exception();
+				 }
+			 });
+
+	MergePartialIndexes(documents, partial_indexes);
 }
 
-vector<Document> SearchServer::FindTopDocuments(std::execution::parallel_policy policy, const string_view raw_query, DocumentStatus status) const
+void SearchServer::CheckNewDocuments(const vector<const RawDocument *> &documents) const
 {
-	return FindTopDocuments(std::execution::par, raw_query, [status](int document_id, DocumentStatus document_status, int rating)
-	                        { return document_status == status; });
+	unordered_set<int> batch_ids;
+	for (const RawDocument *document : documents)
+	{
+		if ((document->id < 0) || (documents_.count(document->id) > 0) || !batch_ids.insert(document->id).second)
+		{
+			throw invalid_argument("Invalid document_id"s);
+		}
+		if (static_cast<size_t>(document->status) >= STATUS_COUNT)
+		{
+			throw invalid_argument("Invalid document status"s);
+		}
+	}
+}
+
+void SearchServer::BuildPartialIndex(const vector<const RawDocument *> &documents, size_t first, size_t last, PartialIndex &partial_index) const
+{
+	vector<uint32_t> document_terms;
+
+	for (size_t position = first; position < last; ++position)
+	{
+		const auto words = SplitIntoWordsNoStop(documents[position]->text);
+		uint32_t word_count = 0;
+
+		document_terms.clear();
+		for (const string_view word : words)
+		{
+			const auto [it, inserted] = partial_index.term_ids.emplace(word, static_cast<uint32_t>(partial_index.terms.size()));
+			if (inserted)
+			{
+				partial_index.terms.push_back(word);
+				partial_index.postings.emplace_back();
+			}
+			const uint32_t local_id = it->second;
+			if (partial_index.postings[local_id].empty() || partial_index.postings[local_id].back().document_ordinal != position)
+			{
+				partial_index.postings[local_id].push_back({static_cast<DocumentOrdinal>(position), 0});
+				document_terms.push_back(local_id);
+			}
+			++partial_index.postings[local_id].back().count;
+			++word_count;
+		}
+
+		auto &document_term_counts = partial_index.document_term_counts.emplace_back();
+		document_term_counts.reserve(document_terms.size());
+		for (const uint32_t local_id : document_terms)
+		{
+			document_term_counts.emplace_back(local_id, partial_index.postings[local_id].back().count);
+		}
+		partial_index.word_counts.push_back(word_count);
+	}
+}
+
+void SearchServer::MergePartialIndexes(const vector<const RawDocument *> &documents, vector<PartialIndex> &partial_indexes)
+{
+	for (const PartialIndex &partial_index : partial_indexes)
+	{
+		if (partial_index.error)
+		{
+			rethrow_exception(partial_index.error);
+		}
+	}
+
+	const auto first_ordinal = static_cast<DocumentOrdinal>(ordinal_to_document_id_.size());
+	size_t position = 0;
+	vector<TermId> global_ids;
+
+	for (PartialIndex &partial_index : partial_indexes)
+	{
+		// slices are merged in batch order, so every posting list still only grows at its end
+		global_ids.clear();
+		for (const string_view term : partial_index.terms)
+		{
+			global_ids.push_back(terms_.Intern(term));
+		}
+		term_to_document_freqs_.resize(terms_.size());
+		term_document_counts_.resize(terms_.size());
+		term_max_freqs_.resize(terms_.size());
+		idf_cache_.Resize(terms_.size());
+
+		for (size_t local_id = 0; local_id < partial_index.postings.size(); ++local_id)
+		{
+			PostingList &postings = term_to_document_freqs_[global_ids[local_id]];
+			for (const auto &[batch_position, count] : partial_index.postings[local_id])
+			{
+				postings.Add(first_ordinal + batch_position, count);
+				// the slice starts at the current position of the batch
+				const double inverse_word_count = 1.0 / static_cast<double>(partial_index.word_counts[batch_position - position]);
+				term_max_freqs_[global_ids[local_id]] = max(term_max_freqs_[global_ids[local_id]], ComputeTermFreq(count, inverse_word_count));
+			}
+			term_document_counts_[global_ids[local_id]] += static_cast<uint32_t>(partial_index.postings[local_id].size());
+			idf_cache_.InvalidateTerm(global_ids[local_id]);
+		}
+
+		for (size_t slice_position = 0; slice_position < partial_index.document_term_counts.size(); ++slice_position)
+		{
+			const RawDocument &document = *documents[position];
+
+			auto &term_counts = document_to_term_counts_[document.id];
+			for (const auto &[local_id, count] : partial_index.document_term_counts[slice_position])
+			{
+				term_counts.emplace(global_ids[local_id], count);
+			}
+
+			vector<TermId> document_terms;
+			document_terms.reserve(term_counts.size());
+			for (const auto &[term_id, _] : term_counts)
+			{
+				document_terms.push_back(term_id);
+			}
+
+			AppendDocument(document.id, ComputeAverageRating(document.ratings), document.status, partial_index.word_counts[slice_position], move(document_terms));
+			++position;
+		}
+	}
+	idf_cache_.InvalidateDocumentCount();
+	++generation_;
+}
+
+vector<Document> SearchServer::FindTopDocuments(const string_view raw_query, DocumentStatus status, size_t top_count) const
+{
+	return FindTopDocuments(std::execution::seq, PrepareQuery(raw_query), status, top_count);
+}
+
+vector<Document> SearchServer::FindTopDocuments(std::execution::sequenced_policy policy, const string_view raw_query, DocumentStatus status, size_t top_count) const
+{
+	return FindTopDocuments(std::execution::seq, PrepareQuery(raw_query), status, top_count);
+}
+
+vector<Document> SearchServer::FindTopDocuments(std::execution::parallel_policy policy, const string_view raw_query, DocumentStatus status, size_t top_count) const
+{
+	return FindTopDocuments(std::execution::par, PrepareQuery(raw_query), status, top_count);
 }
 
 vector<Document> SearchServer::FindTopDocuments(const string_view raw_query) const
@@ -81,11 +271,63 @@ vector<Document> SearchServer::FindTopDocuments(std::execution::parallel_policy
 	return FindTopDocuments(std::execution::par, raw_query, DocumentStatus::ACTUAL);
 }
 
+vector<Document> SearchServer::FindTopDocuments(const PreparedQuery &query, DocumentStatus status, size_t top_count) const
+{
+	return FindTopDocuments(std::execution::seq, query, status, top_count);
+}
+
+vector<Document> SearchServer::FindTopDocuments(std::execution::sequenced_policy policy, const PreparedQuery &query, DocumentStatus status, size_t top_count) const
+{
+	return FindTopDocumentsCached(std::execution::seq, query, status, top_count);
+}
+
+vector<Document> SearchServer::FindTopDocuments(std::execution::parallel_policy policy, const PreparedQuery &query, DocumentStatus status, size_t top_count) const
+{
+	return FindTopDocumentsCached(std::execution::par, query, status, top_count);
+}
+
+vector<Document> SearchServer::FindTopDocuments(const PreparedQuery &query) const
+{
+	return FindTopDocuments(std::execution::seq, query, DocumentStatus::ACTUAL);
+}
+
+future<vector<Document>> SearchServer::FindTopDocumentsAsync(string raw_query, DocumentStatus status, size_t top_count) const
+{
+	const auto status_index = static_cast<size_t>(status);
+	if (status_index >= STATUS_COUNT || status_documents_[status_index].size() == 0)
+	{
+		// the query is still parsed, so an invalid one fails as in FindTopDocuments
+		return FindTopDocumentsAsyncFiltered(move(raw_query), [](DocumentOrdinal)
+											 { return false; },
+											 top_count, nullopt);
+	}
+	const auto status_filter = [this, status](DocumentOrdinal ordinal)
+	{
+		return IsLiveWithStatus(ordinal, status);
+	};
+	return FindTopDocumentsAsyncFiltered(move(raw_query), status_filter, top_count, status);
+}
+
+vector<Document> SearchServer::FindTopDocuments(std::execution::sequenced_policy policy, const PreparedQuery &query) const
+{
+	return FindTopDocuments(std::execution::seq, query, DocumentStatus::ACTUAL);
+}
+
+vector<Document> SearchServer::FindTopDocuments(std::execution::parallel_policy policy, const PreparedQuery &query) const
+{
+	return FindTopDocuments(std::execution::par, query, DocumentStatus::ACTUAL);
+}
+
 int SearchServer::GetDocumentCount() const
 {
 	return static_cast<int>(documents_.size());
 }
 
+bool SearchServer::HasDocument(int document_id) const
+{
+	return documents_.count(document_id) > 0;
+}
+
 std::set<int>::const_iterator SearchServer::begin() const
 {
 	return document_ids_.begin();
@@ -96,45 +338,41 @@ std::set<int>::const_iterator SearchServer::end() const
 	return document_ids_.end();
 }
 
-const std::map<std::string_view, double> &SearchServer::GetWordFrequencies(int document_id) const
+std::map<std::string_view, double> SearchServer::GetWordFrequencies(int document_id) const
 {
-	static const std::map<std::string_view, double> EMPTY_MAP;
-	if (documents_.count(document_id) > 0)
+	std::map<std::string_view, double> word_freqs;
+	if (const auto it = documents_.find(document_id); it != documents_.end())
 	{
-		return document_to_word_freqs_.at(document_id);
+		const double inverse_word_count = ordinal_inverse_word_counts_[it->second.ordinal];
+		for (const auto &[term_id, count] : document_to_term_counts_.at(document_id))
+		{
+			word_freqs.emplace(terms_.GetTerm(term_id), ComputeTermFreq(count, inverse_word_count));
+		}
 	}
-	return EMPTY_MAP;
+	return word_freqs;
 }
 
 void SearchServer::RemoveDocument(execution::parallel_policy policy, int document_id)
 {
+	const auto it = documents_.find(document_id);
+	if (it == documents_.end())
 	{
-		if (documents_.count(document_id) == 0)
-		{
-			return;
-		}
-
-		map<string_view, double> word_freq = document_to_word_freqs_[document_id];
-		vector<string_view> varStr(word_freq.size());
-
-		transform(
-			execution::par,
-			word_freq.begin(), word_freq.end(),
-			varStr.begin(),
-			[&](auto word)
-			{ return word.first; });
+		return;
+	}
 
-		for_each(
-			execution::par,
-			varStr.begin(), varStr.end(),
-			[&document_id, this](string_view word)
-			{
-				word_to_document_freqs_.find(word)->second.erase(document_id);
-			});
+	const DocumentData &document_data = it->second;
+	// every term of a document is distinct, so the counters are updated independently
+	for_each(
+		execution::par,
+		document_data.terms.begin(), document_data.terms.end(),
+		[this](TermId term_id)
+		{
+			--term_document_counts_[term_id];
+			idf_cache_.InvalidateTerm(term_id);
+		});
+	RemoveDocumentTerms(document_data);
 
-		documents_.erase(document_id);
-		document_ids_.erase(document_id);
-	}
+	documents_.erase(it);
 }
 
 void SearchServer::RemoveDocument(int document_id)
@@ -144,130 +382,600 @@ void SearchServer::RemoveDocument(int document_id)
 
 void SearchServer::RemoveDocument(execution::sequenced_policy policy, int document_id)
 {
-	if (documents_.count(document_id) == 0)
+	const auto it = documents_.find(document_id);
+	if (it == documents_.end())
 	{
 		return;
 	}
 
-	for_each(
-		document_to_word_freqs_.at(document_id).begin(),
-		document_to_word_freqs_.at(document_id).end(),
-		[this, document_id](const auto &word)
-		{
-			word_to_document_freqs_[word.first].erase(document_id);
-		});
+	const DocumentData &document_data = it->second;
+	for (const TermId term_id : document_data.terms)
+	{
+		--term_document_counts_[term_id];
+		idf_cache_.InvalidateTerm(term_id);
+	}
+	RemoveDocumentTerms(document_data);
+
+	documents_.erase(it);
+}
+
+void SearchServer::RemoveDocumentTerms(const DocumentData &document_data)
+{
+	const int document_id = ordinal_to_document_id_[document_data.ordinal];
 
-	documents_.erase(document_id);
+	removed_ordinals_[document_data.ordinal] = true;
+	status_documents_[static_cast<size_t>(ordinal_statuses_[document_data.ordinal])].Remove(document_data.ordinal);
+	removed_posting_count_ += document_data.terms.size();
+	idf_cache_.InvalidateDocumentCount();
+	++generation_;
+
+	document_to_term_counts_.erase(document_id);
 	document_ids_.erase(document_id);
 }
 
-tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const string_view raw_query, int document_id) const
+void SearchServer::AppendIndex(const SearchServer &other, const unordered_set<int> &skipped_document_ids)
 {
-	return MatchDocument(execution::seq, raw_query, document_id);
+	for (const int document_id : other.document_ids_)
+	{
+		if (documents_.count(document_id) > 0 && skipped_document_ids.count(document_id) == 0)
+		{
+			throw invalid_argument("Invalid document_id"s);
+		}
+	}
+
+	// term ids of other mapped to the ids here, interned on first use
+	vector<optional<TermId>> term_ids(other.terms_.size());
+	for (DocumentOrdinal other_ordinal = 0; other_ordinal < other.ordinal_to_document_id_.size(); ++other_ordinal)
+	{
+		const int document_id = other.ordinal_to_document_id_[other_ordinal];
+		if (other.removed_ordinals_[other_ordinal] || skipped_document_ids.count(document_id) > 0)
+		{
+			continue;
+		}
+		const auto document_ordinal = static_cast<DocumentOrdinal>(ordinal_to_document_id_.size());
+
+		auto &term_counts = document_to_term_counts_[document_id];
+		for (const auto &[other_term_id, count] : other.document_to_term_counts_.at(document_id))
+		{
+			if (!term_ids[other_term_id])
+			{
+				term_ids[other_term_id] = terms_.Intern(other.terms_.GetTerm(other_term_id));
+			}
+			term_counts.emplace(*term_ids[other_term_id], count);
+		}
+		term_to_document_freqs_.resize(terms_.size());
+		term_document_counts_.resize(terms_.size());
+		term_max_freqs_.resize(terms_.size());
+		idf_cache_.Resize(terms_.size());
+
+		const double inverse_word_count = other.ordinal_inverse_word_counts_[other_ordinal];
+		vector<TermId> document_terms;
+		document_terms.reserve(term_counts.size());
+		for (const auto &[term_id, count] : term_counts)
+		{
+			term_to_document_freqs_[term_id].Add(document_ordinal, count);
+			++term_document_counts_[term_id];
+			term_max_freqs_[term_id] = max(term_max_freqs_[term_id], ComputeTermFreq(count, inverse_word_count));
+			idf_cache_.InvalidateTerm(term_id);
+			document_terms.push_back(term_id);
+		}
+
+		AppendDocument(document_id, other.ordinal_ratings_[other_ordinal], other.ordinal_statuses_[other_ordinal],
+					   other.ordinal_word_counts_[other_ordinal], move(document_terms));
+	}
+	idf_cache_.InvalidateDocumentCount();
+	++generation_;
 }
 
-tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(execution::parallel_policy policy, const string_view raw_query, int document_id) const
+void SearchServer::Compact()
 {
-	const auto query = ParseQuery(raw_query);
+	vector<DocumentOrdinal> new_ordinals(ordinal_to_document_id_.size());
+	vector<int> ordinal_to_document_id;
+	vector<int> ordinal_ratings;
+	vector<DocumentStatus> ordinal_statuses;
+	vector<uint32_t> ordinal_word_counts;
+	vector<double> ordinal_inverse_word_counts;
+	array<CompressedBitmap, STATUS_COUNT> status_documents;
+	ordinal_to_document_id.reserve(documents_.size());
+	ordinal_ratings.reserve(documents_.size());
+	ordinal_statuses.reserve(documents_.size());
+	ordinal_word_counts.reserve(documents_.size());
+	ordinal_inverse_word_counts.reserve(documents_.size());
+	for (DocumentOrdinal ordinal = 0; ordinal < ordinal_to_document_id_.size(); ++ordinal)
+	{
+		if (!removed_ordinals_[ordinal])
+		{
+			new_ordinals[ordinal] = static_cast<DocumentOrdinal>(ordinal_to_document_id.size());
+			status_documents[static_cast<size_t>(ordinal_statuses_[ordinal])].Add(new_ordinals[ordinal]);
+			ordinal_to_document_id.push_back(ordinal_to_document_id_[ordinal]);
+			ordinal_ratings.push_back(ordinal_ratings_[ordinal]);
+			ordinal_statuses.push_back(ordinal_statuses_[ordinal]);
+			ordinal_word_counts.push_back(ordinal_word_counts_[ordinal]);
+			ordinal_inverse_word_counts.push_back(ordinal_inverse_word_counts_[ordinal]);
+		}
+	}
 
-	std::vector<std::string> plus_words{query.plus_words.begin(), query.plus_words.end()};
-	std::vector<std::string> minus_words{query.minus_words.begin(), query.minus_words.end()};
+	// surviving terms keep their relative order, so sorted term lists stay sorted
+	TermDictionary terms;
+	vector<TermId> new_term_ids(terms_.size());
+	vector<PostingList> term_to_document_freqs;
+	vector<uint32_t> term_document_counts;
+	vector<double> term_max_freqs;
+	for (TermId term_id = 0; term_id < terms_.size(); ++term_id)
+	{
+		if (term_document_counts_[term_id] == 0)
+		{
+			continue;
+		}
+		new_term_ids[term_id] = terms.Intern(terms_.GetTerm(term_id));
 
-	vector<string_view> matched_words;
+		PostingList &postings = term_to_document_freqs.emplace_back();
+		double max_freq = 0.0;
+		for (PostingList::Cursor cursor(term_to_document_freqs_[term_id]); !cursor.IsAtEnd(); cursor.Next())
+		{
+			const DocumentOrdinal document_ordinal = cursor.GetOrdinal();
+			if (!removed_ordinals_[document_ordinal])
+			{
+				postings.Add(new_ordinals[document_ordinal], cursor.GetCount());
+				max_freq = max(max_freq, ComputeTermFreq(cursor.GetCount(), ordinal_inverse_word_counts_[document_ordinal]));
+			}
+		}
+		term_document_counts.push_back(term_document_counts_[term_id]);
+		term_max_freqs.push_back(max_freq);
+	}
 
-	for (const string_view word : documents_.at(document_id).words)
+	for (auto &[document_id, document_data] : documents_)
 	{
-		if (find(minus_words.begin(), minus_words.end(), word) != minus_words.end())
+		document_data.ordinal = new_ordinals[document_data.ordinal];
+		for (TermId &term_id : document_data.terms)
+		{
+			term_id = new_term_ids[term_id];
+		}
+
+		map<TermId, uint32_t> term_counts;
+		for (const auto &[term_id, count] : document_to_term_counts_.at(document_id))
 		{
-			return {matched_words, documents_.at(document_id).status};
+			term_counts.emplace_hint(term_counts.end(), new_term_ids[term_id], count);
 		}
+		document_to_term_counts_[document_id] = move(term_counts);
 	}
 
-	for (const string_view word : documents_.at(document_id).words)
+	terms_ = move(terms);
+	term_to_document_freqs_ = move(term_to_document_freqs);
+	term_document_counts_ = move(term_document_counts);
+	term_max_freqs_ = move(term_max_freqs);
+	ordinal_to_document_id_ = move(ordinal_to_document_id);
+	ordinal_ratings_ = move(ordinal_ratings);
+	ordinal_statuses_ = move(ordinal_statuses);
+	ordinal_word_counts_ = move(ordinal_word_counts);
+	ordinal_inverse_word_counts_ = move(ordinal_inverse_word_counts);
+	status_documents_ = move(status_documents);
+	removed_ordinals_.assign(ordinal_to_document_id_.size(), false);
+	removed_posting_count_ = 0;
+	idf_cache_ = IdfCache();
+	idf_cache_.Resize(terms_.size());
+
+	// nothing refers to a loaded index file anymore
+	index_file_.reset();
+	++generation_;
+}
+
+IndexMemoryStats SearchServer::GetMemoryStats() const
+{
+	IndexMemoryStats stats;
+	stats.document_count = documents_.size();
+	stats.removed_document_count = ordinal_to_document_id_.size() - documents_.size();
+	stats.term_count = terms_.size();
+	stats.unused_term_count = static_cast<size_t>(count(term_document_counts_.begin(), term_document_counts_.end(), 0u));
+	stats.removed_posting_count = removed_posting_count_;
+	stats.term_bytes = terms_.GetMemoryUsage();
+	stats.mapped_bytes = index_file_ ? index_file_->size() : 0;
+
+	stats.posting_bytes = term_to_document_freqs_.capacity() * sizeof(PostingList) + term_document_counts_.capacity() * sizeof(uint32_t);
+	stats.posting_bytes += term_max_freqs_.capacity() * sizeof(double);
+	for (const PostingList &postings : term_to_document_freqs_)
 	{
-		if (find(plus_words.begin(), plus_words.end(), word) != plus_words.end())
+		stats.posting_count += postings.size();
+		stats.posting_bytes += postings.GetMemoryUsage();
+	}
+
+	// red-black tree nodes cost about four pointers on top of their value
+	const size_t node_overhead = 4 * sizeof(void *);
+	stats.document_bytes = ordinal_to_document_id_.capacity() * sizeof(int) + removed_ordinals_.capacity() / 8;
+	stats.document_bytes += ordinal_ratings_.capacity() * sizeof(int) + ordinal_statuses_.capacity() * sizeof(DocumentStatus);
+	stats.document_bytes += ordinal_word_counts_.capacity() * sizeof(uint32_t) + ordinal_inverse_word_counts_.capacity() * sizeof(double);
+	for (const CompressedBitmap &status_documents : status_documents_)
+	{
+		stats.document_bytes += status_documents.GetMemoryUsage();
+	}
+	for (const auto &[document_id, document_data] : documents_)
+	{
+		stats.document_bytes += 2 * node_overhead + sizeof(int) + sizeof(DocumentData) + document_data.terms.capacity() * sizeof(TermId);
+		stats.document_bytes += node_overhead + sizeof(int) + sizeof(map<TermId, uint32_t>);
+		stats.document_bytes += document_to_term_counts_.at(document_id).size() * (node_overhead + sizeof(pair<const TermId, uint32_t>));
+	}
+	return stats;
+}
+
+void SearchServer::SaveIndex(const string &path) const
+{
+	IndexFileWriter writer(path);
+	IndexFileHeader header{};
+
+	vector<uint64_t> offsets{0};
+	string chars;
+	for (size_t index = 0; index < stop_words_.size(); ++index)
+	{
+		chars += stop_words_.GetWord(index);
+		offsets.push_back(chars.size());
+	}
+	header.stop_word_count = stop_words_.size();
+	header.stop_word_offsets = writer.Append(offsets);
+	header.stop_word_chars = writer.Append(chars.data(), chars.size());
+
+	offsets.assign(1, 0);
+	chars.clear();
+	for (TermId term_id = 0; term_id < terms_.size(); ++term_id)
+	{
+		chars += terms_.GetTerm(term_id);
+		offsets.push_back(chars.size());
+	}
+	header.term_count = terms_.size();
+	header.term_offsets = writer.Append(offsets);
+	header.term_chars = writer.Append(chars.data(), chars.size());
+
+	// power of two with a load factor of at most 1/2
+	size_t table_size = 1;
+	while (table_size < terms_.size() * 2)
+	{
+		table_size *= 2;
+	}
+	vector<uint32_t> term_table(terms_.size() == 0 ? 0 : table_size, 0);
+	for (TermId term_id = 0; term_id < terms_.size(); ++term_id)
+	{
+		size_t pos = TermDictionary::Hash(terms_.GetTerm(term_id)) & (table_size - 1);
+		while (term_table[pos] != 0)
 		{
-			matched_words.push_back(word);
+			pos = (pos + 1) & (table_size - 1);
 		}
+		term_table[pos] = term_id + 1;
+	}
+	header.term_table_size = term_table.size();
+	header.term_table = writer.Append(term_table);
+
+	// tombstones are not saved, so lists with removed postings are compressed anew
+	vector<IndexFilePostingList> posting_lists;
+	vector<PostingBlock> posting_blocks;
+	vector<uint32_t> posting_words;
+	vector<Posting> posting_tails;
+	posting_lists.reserve(terms_.size());
+	for (TermId term_id = 0; term_id < terms_.size(); ++term_id)
+	{
+		const PostingList *postings = &term_to_document_freqs_[term_id];
+		PostingList live_postings;
+		if (postings->size() != term_document_counts_[term_id])
+		{
+			for (PostingList::Cursor cursor(*postings); !cursor.IsAtEnd(); cursor.Next())
+			{
+				if (!removed_ordinals_[cursor.GetOrdinal()])
+				{
+					live_postings.Add(cursor.GetOrdinal(), cursor.GetCount());
+				}
+			}
+			postings = &live_postings;
+		}
+
+		posting_lists.push_back({posting_blocks.size(), posting_words.size(), posting_tails.size(),
+								 static_cast<uint32_t>(postings->GetBlockCount()), static_cast<uint32_t>(postings->GetTailSize()),
+								 postings->GetWordCount(), term_max_freqs_[term_id]});
+		posting_blocks.insert(posting_blocks.end(), postings->GetBlocks(), postings->GetBlocks() + postings->GetBlockCount());
+		posting_words.insert(posting_words.end(), postings->GetWords(), postings->GetWords() + postings->GetWordCount());
+		posting_tails.insert(posting_tails.end(), postings->GetTail(), postings->GetTail() + postings->GetTailSize());
 	}
+	header.posting_block_count = posting_blocks.size();
+	header.posting_word_count = posting_words.size();
+	header.posting_tail_count = posting_tails.size();
+	header.posting_lists = writer.Append(posting_lists);
+	header.posting_blocks = writer.Append(posting_blocks);
+	header.posting_words = writer.Append(posting_words);
+	header.posting_tails = writer.Append(posting_tails);
 
-	return {matched_words, documents_.at(document_id).status};
+	const vector<int32_t> ordinals(ordinal_to_document_id_.begin(), ordinal_to_document_id_.end());
+	header.ordinal_count = ordinals.size();
+	header.ordinals = writer.Append(ordinals);
+
+	vector<IndexFileDocument> documents;
+	vector<IndexFileTermCount> document_terms;
+	documents.reserve(documents_.size());
+	for (const auto &[document_id, document_data] : documents_)
+	{
+		const auto &term_counts = document_to_term_counts_.at(document_id);
+		const DocumentOrdinal ordinal = document_data.ordinal;
+		documents.push_back({document_id, ordinal_ratings_[ordinal], static_cast<uint32_t>(ordinal_statuses_[ordinal]), ordinal,
+							 document_terms.size(), term_counts.size(), ordinal_word_counts_[ordinal], 0});
+		for (const auto &[term_id, count] : term_counts)
+		{
+			document_terms.push_back({term_id, count});
+		}
+	}
+	header.document_count = documents.size();
+	header.documents = writer.Append(documents);
+	header.document_term_count = document_terms.size();
+	header.document_terms = writer.Append(document_terms);
+
+	writer.Finish(header);
 }
 
-tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(execution::sequenced_policy policy, const string_view raw_query, int document_id) const
+SearchServer SearchServer::LoadIndex(const string &path)
 {
-	auto query = ParseQuery(raw_query);
+	auto file = make_shared<const MappedFile>(path);
+	const IndexFileHeader &header = ReadIndexFileHeader(*file);
 
-	set<string_view> matched_words;
+	const auto *stop_word_offsets = GetIndexFileSection<uint64_t>(*file, header.stop_word_offsets);
+	const auto *stop_word_chars = GetIndexFileSection<char>(*file, header.stop_word_chars);
+	vector<string_view> stop_words;
+	for (uint64_t i = 0; i < header.stop_word_count; ++i)
+	{
+		stop_words.emplace_back(stop_word_chars + stop_word_offsets[i], stop_word_offsets[i + 1] - stop_word_offsets[i]);
+	}
+	SearchServer server(stop_words);
 
-	/*std::sort(query.plus_words.begin(), query.plus_words.end()); //�������� ��������, ��������� ����� �������� ������
-	auto last_plus = std::unique(query.plus_words.begin(), query.plus_words.end());
-	query.plus_words.erase(last_plus, query.plus_words.end());*/
+	// lookups probe the table until an empty slot and read the terms its slots name
+	const auto *term_table = GetIndexFileSection<uint32_t>(*file, header.term_table);
+	if (header.term_table_size > 0 && find(term_table, term_table + header.term_table_size, 0u) == term_table + header.term_table_size)
+	{
+		throw runtime_error("Index file is corrupted"s);
+	}
+	for (uint64_t i = 0; i < header.term_table_size; ++i)
+	{
+		if (term_table[i] > header.term_count)
+		{
+			throw runtime_error("Index file is corrupted"s);
+		}
+	}
+	server.terms_.AttachMapped(GetIndexFileSection<char>(*file, header.term_chars),
+							   GetIndexFileSection<uint64_t>(*file, header.term_offsets),
+							   header.term_count,
+							   term_table,
+							   header.term_table_size);
 
-	for (const string_view word : query.plus_words)
+	const auto *posting_lists = GetIndexFileSection<IndexFilePostingList>(*file, header.posting_lists);
+	const auto *posting_blocks = GetIndexFileSection<PostingBlock>(*file, header.posting_blocks);
+	const auto *posting_words = GetIndexFileSection<uint32_t>(*file, header.posting_words);
+	const auto *posting_tails = GetIndexFileSection<Posting>(*file, header.posting_tails);
+	server.term_to_document_freqs_.reserve(header.term_count);
+	server.term_document_counts_.reserve(header.term_count);
+	server.term_max_freqs_.reserve(header.term_count);
+	for (uint64_t term_id = 0; term_id < header.term_count; ++term_id)
 	{
-		if (documents_.at(document_id).words.count(word) == 0)
+		const IndexFilePostingList &list = posting_lists[term_id];
+		if (list.first_block > header.posting_block_count || list.block_count > header.posting_block_count - list.first_block ||
+			list.first_word > header.posting_word_count || list.word_count > header.posting_word_count - list.first_word ||
+			list.first_tail_posting > header.posting_tail_count || list.tail_size > header.posting_tail_count - list.first_tail_posting ||
+			list.tail_size >= POSTING_BLOCK_SIZE)
 		{
-			continue;
+			throw runtime_error("Index file is corrupted"s);
 		}
-		if (word_to_document_freqs_.at(word).count(document_id))
+		// cursors unpack the blocks without further checks
+		for (uint64_t i = list.first_block; i < list.first_block + list.block_count; ++i)
 		{
-			matched_words.insert(word);
+			const PostingBlock &block = posting_blocks[i];
+			if (block.ordinal_bit_width > 32 || block.count_bit_width > 32 || block.data_offset > list.word_count ||
+				GetPackedWordCount(block.ordinal_bit_width) + GetPackedWordCount(block.count_bit_width) > list.word_count - block.data_offset)
+			{
+				throw runtime_error("Index file is corrupted"s);
+			}
 		}
+
+		PostingList postings = PostingList::View(posting_blocks + list.first_block, list.block_count, posting_words + list.first_word, list.word_count,
+												 posting_tails + list.first_tail_posting, list.tail_size);
+		// ordinals index the per-ordinal arrays below
+		if (!postings.AreOrdinalsValid(static_cast<DocumentOrdinal>(header.ordinal_count)))
+		{
+			throw runtime_error("Index file is corrupted"s);
+		}
+		server.term_document_counts_.push_back(static_cast<uint32_t>(postings.size()));
+		server.term_max_freqs_.push_back(list.max_term_freq);
+		server.term_to_document_freqs_.push_back(move(postings));
 	}
-	for (const string_view word : query.minus_words)
+	server.idf_cache_.Resize(header.term_count);
+
+	const auto *ordinals = GetIndexFileSection<int32_t>(*file, header.ordinals);
+	server.ordinal_to_document_id_.assign(ordinals, ordinals + header.ordinal_count);
+	// ordinals without a document record belong to removed documents
+	server.removed_ordinals_.assign(header.ordinal_count, true);
+	server.ordinal_ratings_.assign(header.ordinal_count, 0);
+	server.ordinal_statuses_.assign(header.ordinal_count, DocumentStatus::REMOVED);
+	server.ordinal_word_counts_.assign(header.ordinal_count, 0);
+	server.ordinal_inverse_word_counts_.assign(header.ordinal_count, 0.0);
+
+	const auto *documents = GetIndexFileSection<IndexFileDocument>(*file, header.documents);
+	const auto *document_terms = GetIndexFileSection<IndexFileTermCount>(*file, header.document_terms);
+	for (uint64_t i = 0; i < header.document_count; ++i)
 	{
-		if (documents_.at(document_id).words.count(word) == 0)
+		const IndexFileDocument &document = documents[i];
+		if (document.ordinal >= header.ordinal_count || !server.removed_ordinals_[document.ordinal] || document.status >= STATUS_COUNT || document.first_term > header.document_term_count || document.term_count > header.document_term_count - document.first_term)
 		{
-			continue;
+			throw runtime_error("Index file is corrupted"s);
 		}
-		if (word_to_document_freqs_.at(word).count(document_id))
+		// a document is stored once and its ordinal maps back to it
+		if (ordinals[document.ordinal] != document.id || server.documents_.count(document.id) > 0)
 		{
-			matched_words.clear();
-			break;
+			throw runtime_error("Index file is corrupted"s);
+		}
+
+		auto &term_counts = server.document_to_term_counts_[document.id];
+		vector<TermId> terms;
+		terms.reserve(document.term_count);
+		for (uint64_t j = document.first_term; j < document.first_term + document.term_count; ++j)
+		{
+			if (document_terms[j].term_id >= header.term_count)
+			{
+				throw runtime_error("Index file is corrupted"s);
+			}
+			term_counts.emplace_hint(term_counts.end(), document_terms[j].term_id, document_terms[j].count);
+			terms.push_back(document_terms[j].term_id);
+		}
+
+		server.documents_.emplace(document.id, DocumentData{document.ordinal, move(terms)});
+		server.removed_ordinals_[document.ordinal] = false;
+		server.ordinal_ratings_[document.ordinal] = document.rating;
+		server.ordinal_statuses_[document.ordinal] = static_cast<DocumentStatus>(document.status);
+		server.ordinal_word_counts_[document.ordinal] = document.word_count;
+		server.ordinal_inverse_word_counts_[document.ordinal] = 1.0 / static_cast<double>(document.word_count);
+		server.document_ids_.emplace(document.id);
+	}
+	// built in ordinal order, so every bitmap is filled by appending
+	for (DocumentOrdinal ordinal = 0; ordinal < header.ordinal_count; ++ordinal)
+	{
+		if (!server.removed_ordinals_[ordinal])
+		{
+			server.status_documents_[static_cast<size_t>(server.ordinal_statuses_[ordinal])].Add(ordinal);
 		}
 	}
 
-	vector<string_view> matched_words_vector(matched_words.size());
+	server.index_file_ = move(file);
+	return server;
+}
+
+tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const string_view raw_query, int document_id) const
+{
+	return MatchDocument(execution::seq, raw_query, document_id);
+}
+
+tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(execution::parallel_policy policy, const string_view raw_query, int document_id) const
+{
+	return MatchDocument(execution::par, PrepareQuery(raw_query), document_id);
+}
 
-	transform(
-		matched_words.begin(), matched_words.end(),
-		matched_words_vector.begin(),
-		[](auto word)
-		{ return word; });
+tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(execution::sequenced_policy policy, const string_view raw_query, int document_id) const
+{
+	return MatchDocument(execution::seq, PrepareQuery(raw_query), document_id);
+}
 
-	return {matched_words_vector, documents_.at(document_id).status};
+tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const PreparedQuery &query, int document_id) const
+{
+	return MatchDocument(execution::seq, query, document_id);
 }
 
-bool SearchServer::IsStopWord(const string &word) const
+tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(execution::parallel_policy policy, const PreparedQuery &query, int document_id) const
 {
-	return stop_words_.count(word) > 0;
+	CheckPreparedQuery(query);
+	const auto &document_data = documents_.at(document_id);
+
+	const auto contains_term = [&document_data](TermId term_id)
+	{
+		return binary_search(document_data.terms.begin(), document_data.terms.end(), term_id);
+	};
+
+	vector<string_view> matched_words;
+
+	if (any_of(execution::par, query.minus_terms_.begin(), query.minus_terms_.end(), contains_term))
+	{
+		return {matched_words, ordinal_statuses_[document_data.ordinal]};
+	}
+
+	vector<TermId> matched_terms(query.plus_terms_.size());
+	matched_terms.erase(
+		copy_if(execution::par,
+				query.plus_terms_.begin(), query.plus_terms_.end(),
+				matched_terms.begin(),
+				contains_term),
+		matched_terms.end());
+
+	// the terms are unique, only their texts need ordering
+	matched_words.reserve(matched_terms.size());
+	for (const TermId term_id : matched_terms)
+	{
+		matched_words.push_back(terms_.GetTerm(term_id));
+	}
+	sort(matched_words.begin(), matched_words.end());
+
+	return {matched_words, ordinal_statuses_[document_data.ordinal]};
 }
 
-bool SearchServer::IsValidWord(const string &word)
+tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(execution::sequenced_policy policy, const PreparedQuery &query, int document_id) const
+{
+	CheckPreparedQuery(query);
+	const auto &document_data = documents_.at(document_id);
+
+	const auto contains_term = [&document_data](TermId term_id)
+	{
+		return binary_search(document_data.terms.begin(), document_data.terms.end(), term_id);
+	};
+
+	vector<string_view> matched_words;
+
+	if (any_of(query.minus_terms_.begin(), query.minus_terms_.end(), contains_term))
+	{
+		return {matched_words, ordinal_statuses_[document_data.ordinal]};
+	}
+
+	for (const TermId term_id : query.plus_terms_)
+	{
+		if (contains_term(term_id))
+		{
+			matched_words.push_back(terms_.GetTerm(term_id));
+		}
+	}
+	sort(matched_words.begin(), matched_words.end());
+
+	return {matched_words, ordinal_statuses_[document_data.ordinal]};
+}
+
+bool SearchServer::IsStopWord(const string_view word) const
+{
+	return stop_words_.Contains(word);
+}
+
+bool SearchServer::IsValidWord(const string_view word)
 {
 	return none_of(word.begin(), word.end(), [](char c)
 				   { return c >= '\0' && c < ' '; });
 }
 
-deque<string_view> SearchServer::SplitIntoWordsNoStop(const string_view text) const
+SearchServer::DocumentWordRange SearchServer::SplitIntoWordsNoStop(const string_view text) const
 {
-	deque<string_view> words;
-
-	auto vec = SplitIntoWords(text);
+	return {*this, text};
+}
 
-	for (const string_view word : vec)
+void SearchServer::DocumentWordRange::Iterator::SkipStopWords()
+{
+	for (; it_ != WordRange::Iterator(); ++it_)
 	{
-		if (!IsValidWord(string(word)))
+		if (it_.HasControlCharacters())
 		{
-			throw invalid_argument("Word "s + string(word) + " is invalid"s);
+			throw invalid_argument("Word "s + string(*it_) + " is invalid"s);
 		}
-		if (!IsStopWord(string(word)))
+		if (!server_->IsStopWord(*it_))
+		{
+			break;
+		}
+	}
+}
+
+ScoreAccumulator &SearchServer::GetThreadScoreAccumulator()
+{
+	// reused by every query running on this thread, so scoring does not allocate
+	thread_local ScoreAccumulator accumulator;
+	return accumulator;
+}
+
+const DocumentBitmap *SearchServer::FindExcludedDocuments(const PreparedQuery &query, DocumentBitmap &excluded_documents) const
+{
+	if (query.minus_terms_.empty())
+	{
+		return nullptr;
+	}
+	excluded_documents.Reset(ordinal_to_document_id_.size());
+	for (const TermId term_id : query.minus_terms_)
+	{
+		for (PostingList::Cursor cursor(term_to_document_freqs_[term_id]); !cursor.IsAtEnd(); cursor.Next())
 		{
-			words.push_back(word);
+			excluded_documents.Set(cursor.GetOrdinal());
 		}
 	}
-	return words;
+	return &excluded_documents;
 }
 
 int SearchServer::ComputeAverageRating(const vector<int> &ratings)
@@ -297,36 +1005,167 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(const string_view text) con
 		word = word.substr(1);
 	}
 
-	if (word.empty() || word[0] == '-' || !IsValidWord(string(word)))
+	if (word.empty() || word[0] == '-' || !IsValidWord(word))
 	{
 		throw invalid_argument("Query word "s + string(word) + " is invalid");
 	}
 
-	return {word, is_minus, IsStopWord(string(word))};
+	return {word, is_minus, IsStopWord(word)};
+}
+
+void SearchServer::SetResultCacheCapacity(size_t capacity)
+{
+	result_cache_.SetCapacity(capacity);
+}
+
+QueryCacheStats SearchServer::GetResultCacheStats() const
+{
+	return result_cache_.GetStats();
+}
+
+void SearchServer::SetThreadPool(shared_ptr<ThreadPool> thread_pool)
+{
+	thread_pool_ = move(thread_pool);
+}
+
+ThreadPool &SearchServer::GetThreadPool() const
+{
+	return thread_pool_ ? *thread_pool_ : ThreadPool::GetDefault();
+}
+
+PreparedQuery SearchServer::PrepareQuery(const string_view raw_query) const
+{
+	PreparedQuery query = ParseQuery(raw_query);
+
+	vector<int> document_freqs;
+	document_freqs.reserve(query.plus_terms_.size());
+	query.inverse_document_freqs_.reserve(query.plus_terms_.size());
+	for (const TermId term_id : query.plus_terms_)
+	{
+		document_freqs.push_back(static_cast<int>(term_document_counts_[term_id]));
+		query.inverse_document_freqs_.push_back(ComputeTermInverseDocumentFreq(term_id));
+	}
+	SetPruningOrder(query, document_freqs);
+	return query;
+}
+
+PreparedQuery SearchServer::PrepareQuery(const string_view raw_query, const CollectionStatistics &statistics) const
+{
+	PreparedQuery query = ParseQuery(raw_query);
+	query.has_collection_statistics_ = true;
+
+	// a word no live document of the collection contains matches nothing, as in PrepareQuery
+	const auto get_document_freq = [this, &statistics](TermId term_id)
+	{
+		const auto it = statistics.document_freqs.find(terms_.GetTerm(term_id));
+		return it == statistics.document_freqs.end() ? 0 : it->second;
+	};
+	query.plus_terms_.erase(remove_if(query.plus_terms_.begin(), query.plus_terms_.end(),
+									  [&get_document_freq](TermId term_id)
+									  {
+										  return get_document_freq(term_id) <= 0;
+									  }),
+							query.plus_terms_.end());
+
+	vector<int> document_freqs;
+	document_freqs.reserve(query.plus_terms_.size());
+	query.inverse_document_freqs_.reserve(query.plus_terms_.size());
+	// the same expression as IdfCache, so a part scores exactly as a single index would
+	const double log_document_count = log(static_cast<double>(statistics.document_count));
+	for (const TermId term_id : query.plus_terms_)
+	{
+		const int document_freq = get_document_freq(term_id);
+		if (document_freq > statistics.document_count)
+		{
+			throw invalid_argument("Invalid collection statistics"s);
+		}
+		document_freqs.push_back(document_freq);
+		query.inverse_document_freqs_.push_back(log_document_count - log(static_cast<double>(document_freq)));
+	}
+	SetPruningOrder(query, document_freqs);
+	return query;
+}
+
+CollectionStatistics SearchServer::GetQueryStatistics(const string_view raw_query) const
+{
+	const PreparedQuery query = ParseQuery(raw_query);
+
+	CollectionStatistics statistics;
+	statistics.document_count = GetDocumentCount();
+	for (const TermId term_id : query.plus_terms_)
+	{
+		statistics.document_freqs.emplace(terms_.GetTerm(term_id), static_cast<int>(term_document_counts_[term_id]));
+	}
+	return statistics;
 }
 
-SearchServer::Query SearchServer::ParseQuery(const std::string_view text) const
+PreparedQuery SearchServer::ParseQuery(const string_view raw_query) const
 {
-	SearchServer::Query result;
-	for (const auto word : SplitIntoWords(text))
+	PreparedQuery query;
+	query.server_ = this;
+	query.generation_ = generation_;
+
+	for (const string_view word : WordRange(raw_query))
 	{
 		const auto query_word = ParseQueryWord(word);
-		if (!query_word.is_stop)
+		if (query_word.is_stop)
 		{
-			if (query_word.is_minus)
-			{
-				result.minus_words.push_back(query_word.data);
-			}
-			else
-			{
-				result.plus_words.push_back(query_word.data);
-			}
+			continue;
+		}
+		const auto term_id = terms_.Find(query_word.data);
+		if (!term_id || term_document_counts_[*term_id] == 0)
+		{
+			continue;
+		}
+		if (query_word.is_minus)
+		{
+			query.minus_terms_.push_back(*term_id);
+		}
+		else
+		{
+			query.plus_terms_.push_back(*term_id);
 		}
 	}
-	return result;
+
+	sort(query.plus_terms_.begin(), query.plus_terms_.end());
+	query.plus_terms_.erase(unique(query.plus_terms_.begin(), query.plus_terms_.end()), query.plus_terms_.end());
+	sort(query.minus_terms_.begin(), query.minus_terms_.end());
+	query.minus_terms_.erase(unique(query.minus_terms_.begin(), query.minus_terms_.end()), query.minus_terms_.end());
+	return query;
+}
+
+void SearchServer::SetPruningOrder(PreparedQuery &query, const vector<int> &document_freqs) const
+{
+	query.pruning_order_.resize(query.plus_terms_.size());
+	iota(query.pruning_order_.begin(), query.pruning_order_.end(), 0);
+	// ties are broken by the words rather than by term ids, which differ between the parts
+	// of a collection, so every part adds up the terms of a document in the same order
+	sort(query.pruning_order_.begin(), query.pruning_order_.end(),
+		 [this, &query, &document_freqs](uint32_t lhs, uint32_t rhs)
+		 {
+			 if (document_freqs[lhs] != document_freqs[rhs])
+			 {
+				 return document_freqs[lhs] > document_freqs[rhs];
+			 }
+			 return terms_.GetTerm(query.plus_terms_[lhs]) < terms_.GetTerm(query.plus_terms_[rhs]);
+		 });
+	query.pruning_bound_sums_.assign(1, 0.0);
+	for (const uint32_t i : query.pruning_order_)
+	{
+		const double bound = term_max_freqs_[query.plus_terms_[i]] * query.inverse_document_freqs_[i];
+		query.pruning_bound_sums_.push_back(query.pruning_bound_sums_.back() + bound);
+	}
+}
+
+void SearchServer::CheckPreparedQuery(const PreparedQuery &query) const
+{
+	if (query.server_ != this || query.generation_ != generation_)
+	{
+		throw invalid_argument("Query was prepared for another state of the index"s);
+	}
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const string_view word) const
+double SearchServer::ComputeTermInverseDocumentFreq(TermId term_id) const
 {
-	return log(GetDocumentCount() * 1.0 / static_cast<double>(word_to_document_freqs_.at(word).size()));
+	return idf_cache_.Get(term_id, GetDocumentCount(), term_document_counts_[term_id]);
 }
\ No newline at end of file
@@ -1,26 +1,101 @@
 #pragma once
+#include <array>
 #include <set>
 #include <vector>
 #include <string>
 #include <string_view>
 #include <map>
-#include <deque>
 #include <algorithm>
 #include <cmath>
+#include <numeric>
 #include <utility>
-#include <future>
 #include <atomic>
 #include <functional>
+#include <iterator>
+#include <memory>
 #include <stdexcept>
 #include <execution>
+#include <exception>
+#include <future>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <thread>
 #include "string_processing.h"
+#include "compressed_bitmap.h"
 #include "document.h"
-#include "concurrent_map.h"
+#include "document_bitmap.h"
+#include "idf_cache.h"
+#include "index_file.h"
+#include "posting_list.h"
+#include "query_result_cache.h"
+#include "score_accumulator.h"
+#include "stop_word_set.h"
+#include "term_dictionary.h"
+#include "text_scanner.h"
+#include "thread_pool.h"
+#include "top_documents.h"
 
 using namespace std::string_literals;
-const double precision = 1e-10;
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 
+// Size of the index. Removed documents stay in the posting lists as tombstones
+// until SearchServer::Compact, byte counts are heap estimates
+struct IndexMemoryStats
+{
+	size_t document_count = 0;
+	size_t removed_document_count = 0;
+	size_t term_count = 0;
+	size_t unused_term_count = 0;
+	size_t posting_count = 0;
+	size_t removed_posting_count = 0;
+	size_t posting_bytes = 0;
+	size_t term_bytes = 0;
+	size_t document_bytes = 0;
+	size_t mapped_bytes = 0;
+};
+
+// Document counts of a collection indexed in parts, such as segments or shards: all its
+// live documents and, by word, the live documents containing it. Queries prepared with them
+// score documents of every part as one index over the whole collection would.
+struct CollectionStatistics
+{
+	int document_count = 0;
+	std::map<std::string, int, std::less<>> document_freqs;
+
+	// Adds the counts of another part of the collection
+	void Add(const CollectionStatistics &other);
+};
+
+class SearchServer;
+
+// Query parsed and resolved against the index of a SearchServer: words are mapped to
+// term ids, plus terms carry their inverse document frequency and both term lists are
+// sorted and deduplicated. It can be run any number of times, with any predicate or
+// status, until the server's index changes.
+class PreparedQuery
+{
+public:
+	PreparedQuery() = default;
+
+private:
+	friend class SearchServer;
+
+	const SearchServer *server_ = nullptr;
+	uint64_t generation_ = 0;
+	// only terms of live documents are kept, words absent from the index are dropped
+	std::vector<TermId> plus_terms_;
+	std::vector<double> inverse_document_freqs_;
+	std::vector<TermId> minus_terms_;
+	// MaxScore pruning: plus term indexes from the most common term to the rarest one and the
+	// sums of the bounds (max term_freq times idf) of the first k terms. The order depends only
+	// on live document counts, so relevances are summed alike in every copy of the index.
+	std::vector<uint32_t> pruning_order_;
+	std::vector<double> pruning_bound_sums_;
+	// scored with the counts of a collection, results depend on more than the index
+	bool has_collection_statistics_ = false;
+};
+
 class SearchServer
 {
 public:
@@ -28,11 +103,14 @@ public:
 
 	template <typename StringContainer>
 	explicit SearchServer(const StringContainer &stop_words)
-		: stop_words_(MakeUniqueNonEmptyStrings(stop_words))
+		: stop_words_(stop_words)
 	{
-		if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord))
+		for (size_t index = 0; index < stop_words_.size(); ++index)
 		{
-			throw std::invalid_argument("Some of stop words are invalid"s);
+			if (!IsValidWord(stop_words_.GetWord(index)))
+			{
+				throw std::invalid_argument("Some of stop words are invalid"s);
+			}
 		}
 	}
 
@@ -41,41 +119,156 @@ public:
 
 	void AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int> &ratings);
 
+	// Adds a range of RawDocument with the same result as calling AddDocument for each
+	// of them in order. Nothing is added if any document is invalid.
+	// The parallel version tokenizes slices of the range concurrently into partial
+	// indexes and merges them into the posting lists in a single pass.
+	template <typename DocumentRange>
+	void AddDocuments(std::execution::sequenced_policy policy, const DocumentRange &documents);
+	template <typename DocumentRange>
+	void AddDocuments(std::execution::parallel_policy policy, const DocumentRange &documents);
+	template <typename DocumentRange>
+	void AddDocuments(const DocumentRange &documents);
+
 	template <typename DocumentPredicate>
-	std::vector<Document> FindTopDocuments(std::execution::sequenced_policy policy, const std::string_view raw_query, DocumentPredicate document_predicate) const;
+	std::vector<Document> FindTopDocuments(std::execution::sequenced_policy policy, const std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
 	template <typename DocumentPredicate>
-	std::vector<Document> FindTopDocuments(std::execution::parallel_policy policy, const std::string_view raw_query, DocumentPredicate document_predicate) const;
+	std::vector<Document> FindTopDocuments(std::execution::parallel_policy policy, const std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
 	template <typename DocumentPredicate>
-	std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const;
+	std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
-	[[nodiscard]] std::vector<Document> FindTopDocuments(std::execution::sequenced_policy policy, const std::string_view raw_query, DocumentStatus status) const;
-	[[nodiscard]] std::vector<Document> FindTopDocuments(std::execution::parallel_policy policy, const std::string_view raw_query, DocumentStatus status) const;
-	[[nodiscard]] std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const;
+	[[nodiscard]] std::vector<Document> FindTopDocuments(std::execution::sequenced_policy policy, const std::string_view raw_query, DocumentStatus status, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	[[nodiscard]] std::vector<Document> FindTopDocuments(std::execution::parallel_policy policy, const std::string_view raw_query, DocumentStatus status, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	[[nodiscard]] std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
 	[[nodiscard]] std::vector<Document> FindTopDocuments(std::execution::sequenced_policy policy, const std::string_view raw_query) const;
 	[[nodiscard]] std::vector<Document> FindTopDocuments(std::execution::parallel_policy policy, const std::string_view raw_query) const;
 	[[nodiscard]] std::vector<Document> FindTopDocuments(const std::string_view raw_query) const;
 
+	// Parses raw_query once for the FindTopDocuments and MatchDocument overloads below.
+	// Running a prepared query after the index has changed throws std::invalid_argument.
+	[[nodiscard]] PreparedQuery PrepareQuery(const std::string_view raw_query) const;
+	// Prepares raw_query to be scored with the inverse document frequencies of a collection
+	// this index is a part of. Plus words the statistics do not count are dropped, counts
+	// above the document count throw std::invalid_argument. Such queries bypass the result cache.
+	[[nodiscard]] PreparedQuery PrepareQuery(const std::string_view raw_query, const CollectionStatistics &statistics) const;
+	// Counts of this index for the plus words of raw_query, to be added up over the parts
+	// of a collection; throws std::invalid_argument for an invalid query
+	[[nodiscard]] CollectionStatistics GetQueryStatistics(const std::string_view raw_query) const;
+
+	template <typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(std::execution::sequenced_policy policy, const PreparedQuery &query, DocumentPredicate document_predicate, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	template <typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(std::execution::parallel_policy policy, const PreparedQuery &query, DocumentPredicate document_predicate, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	template <typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(const PreparedQuery &query, DocumentPredicate document_predicate, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+	[[nodiscard]] std::vector<Document> FindTopDocuments(std::execution::sequenced_policy policy, const PreparedQuery &query, DocumentStatus status, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	[[nodiscard]] std::vector<Document> FindTopDocuments(std::execution::parallel_policy policy, const PreparedQuery &query, DocumentStatus status, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	[[nodiscard]] std::vector<Document> FindTopDocuments(const PreparedQuery &query, DocumentStatus status, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+	[[nodiscard]] std::vector<Document> FindTopDocuments(std::execution::sequenced_policy policy, const PreparedQuery &query) const;
+	[[nodiscard]] std::vector<Document> FindTopDocuments(std::execution::parallel_policy policy, const PreparedQuery &query) const;
+	[[nodiscard]] std::vector<Document> FindTopDocuments(const PreparedQuery &query) const;
+
+	// Run FindTopDocuments on the thread pool and return at once. Parsing, the scoring of
+	// ordinal ranges and the merge of their results are separate tasks that hand the query
+	// on to each other, so the stages of many queries interleave on the workers and no
+	// worker blocks on a query. The server must outlive the future and stay unchanged until
+	// it is ready; waiting for the future inside a task of the same pool may deadlock.
+	[[nodiscard]] std::future<std::vector<Document>> FindTopDocumentsAsync(std::string raw_query, DocumentStatus status = DocumentStatus::ACTUAL, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	template <typename DocumentPredicate>
+	std::future<std::vector<Document>> FindTopDocumentsAsync(std::string raw_query, DocumentPredicate document_predicate, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+	// Keeps the results of up to capacity FindTopDocuments calls by status, 0 (the default)
+	// disables the cache. Entries are dropped when the index changes; calls with
+	// a predicate are never cached.
+	void SetResultCacheCapacity(size_t capacity);
+	[[nodiscard]] QueryCacheStats GetResultCacheStats() const;
+
+	// Threads that run the par overloads of FindTopDocuments and ProcessQueries.
+	// nullptr (the default) selects ThreadPool::GetDefault(); copies share the pool.
+	void SetThreadPool(std::shared_ptr<ThreadPool> thread_pool);
+	[[nodiscard]] ThreadPool &GetThreadPool() const;
+
 	[[nodiscard]] int GetDocumentCount() const;
-	[[nodiscard]] const std::map<std::string_view, double> &GetWordFrequencies(int document_id) const;
+	[[nodiscard]] bool HasDocument(int document_id) const;
+	[[nodiscard]] std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
 
+	// Removal frees the document record at once and leaves a tombstone in the posting
+	// lists, which queries skip. Compact reclaims the tombstones.
 	void RemoveDocument(int document_id);
 	void RemoveDocument(std::execution::parallel_policy policy, int document_id);
 	void RemoveDocument(std::execution::sequenced_policy policy, int document_id);
 
+	// Appends the live documents of other, except skipped_document_ids, with their term
+	// frequencies, ratings and statuses, as if they had been added here in ordinal order.
+	// Throws std::invalid_argument if one of them is already indexed; nothing is changed then.
+	void AppendIndex(const SearchServer &other, const std::unordered_set<int> &skipped_document_ids = {});
+
+	// Drops removed documents from the posting lists, forgets terms no live document
+	// contains and renumbers documents and terms densely
+	void Compact();
+	[[nodiscard]] IndexMemoryStats GetMemoryStats() const;
+
 	[[nodiscard]] std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::string_view raw_query, int document_id) const;
 	[[nodiscard]] std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::execution::sequenced_policy policy, const std::string_view raw_query, int document_id) const;
 	[[nodiscard]] std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::execution::parallel_policy policy, const std::string_view raw_query, int document_id) const;
 
+	[[nodiscard]] std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const PreparedQuery &query, int document_id) const;
+	[[nodiscard]] std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::execution::sequenced_policy policy, const PreparedQuery &query, int document_id) const;
+	[[nodiscard]] std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::execution::parallel_policy policy, const PreparedQuery &query, int document_id) const;
+
+	// Writes the whole index to a versioned binary file (see index_file.h)
+	void SaveIndex(const std::string &path) const;
+	// Maps a file written by SaveIndex. Term texts and posting lists are used in place,
+	// the mapping stays alive as long as the server does
+	[[nodiscard]] static SearchServer LoadIndex(const std::string &path);
+
 	std::set<int>::const_iterator begin() const;
 	std::set<int>::const_iterator end() const;
 
 private:
+	// rating and status live in the ordinal columns of the server
 	struct DocumentData
 	{
-		int rating;
-		DocumentStatus status;
-		std::set<std::string_view> words;
+		DocumentOrdinal ordinal;
+		std::vector<TermId> terms;
+	};
+	// Index of a slice of an AddDocuments batch with terms numbered locally;
+	// postings refer to documents by their position in the batch
+	struct PartialIndex
+	{
+		std::unordered_map<std::string_view, uint32_t> term_ids;
+		std::vector<std::string_view> terms;
+		std::vector<std::vector<Posting>> postings;
+		std::vector<std::vector<std::pair<uint32_t, uint32_t>>> document_term_counts;
+		std::vector<uint32_t> word_counts;
+		std::exception_ptr error;
+	};
+	// State of a FindTopDocumentsAsync call shared by the tasks of its stages
+	template <typename OrdinalFilter>
+	struct AsyncSearch
+	{
+		AsyncSearch(std::string raw_query, OrdinalFilter ordinal_filter, size_t top_count, std::optional<DocumentStatus> cached_status)
+			: raw_query(std::move(raw_query)), ordinal_filter(std::move(ordinal_filter)), top_count(top_count), cached_status(cached_status)
+		{
+		}
+
+		std::string raw_query;
+		OrdinalFilter ordinal_filter;
+		size_t top_count;
+		// set for searches by status while the result cache is enabled
+		std::optional<DocumentStatus> cached_status;
+		PreparedQuery query;
+		DocumentBitmap excluded_documents_buffer;
+		const DocumentBitmap *excluded_documents = nullptr;
+		size_t chunk_size = 0;
+		std::vector<TopDocuments> chunk_tops;
+		std::atomic<size_t> pending_chunk_count{0};
+		std::mutex error_mutex;
+		std::exception_ptr error;
+		std::promise<std::vector<Document>> result;
 	};
 	struct QueryWord
 	{
@@ -83,218 +276,596 @@ private:
 		bool is_minus;
 		bool is_stop;
 	};
-	struct Query
+	// Lazy range over the words of a document that are not stop words.
+	// Every word is validated as the iteration reaches it.
+	class DocumentWordRange
 	{
-		std::deque<std::string_view> plus_words;
-		std::deque<std::string_view> minus_words;
-	};
+	public:
+		class Iterator
+		{
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = std::string_view;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const std::string_view *;
+			using reference = const std::string_view &;
+
+			Iterator(const SearchServer &server, WordRange::Iterator it)
+				: server_(&server), it_(it)
+			{
+				SkipStopWords();
+			}
 
-	const std::set<std::string, std::less<>> stop_words_;
+			reference operator*() const
+			{
+				return *it_;
+			}
 
-	std::unordered_set<std::string> unique_words;
-	std::string_view AddUniqueWord(const std::string &word);
+			Iterator &operator++()
+			{
+				++it_;
+				SkipStopWords();
+				return *this;
+			}
 
-	std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-	std::map<int, std::map<std::string_view, double>> document_to_word_freqs_;
+			bool operator==(const Iterator &other) const
+			{
+				return it_ == other.it_;
+			}
 
-	std::map<int, DocumentData> documents_;
-	std::set<int> document_ids_;
+			bool operator!=(const Iterator &other) const
+			{
+				return it_ != other.it_;
+			}
 
-	[[nodiscard]] bool IsStopWord(const std::string &word) const;
+		private:
+			void SkipStopWords();
 
-	static bool IsValidWord(const std::string &word);
+			const SearchServer *server_;
+			WordRange::Iterator it_;
+		};
 
-	[[nodiscard]] std::deque<std::string_view> SplitIntoWordsNoStop(const std::string_view text) const;
+		DocumentWordRange(const SearchServer &server, std::string_view text)
+			: server_(server), words_(text)
+		{
+		}
 
-	[[nodiscard]] Query ParseQuery(const std::string_view text) const;
-	[[nodiscard]] QueryWord ParseQueryWord(const std::string_view text) const;
+		[[nodiscard]] Iterator begin() const
+		{
+			return {server_, words_.begin()};
+		}
 
-	[[nodiscard]] static int ComputeAverageRating(const std::vector<int> &ratings);
-	[[nodiscard]] double ComputeWordInverseDocumentFreq(const std::string_view word) const;
+		[[nodiscard]] Iterator end() const
+		{
+			return {server_, words_.end()};
+		}
 
-	template <typename DocumentPredicate>
-	std::vector<Document> FindAllDocuments(const Query &query, DocumentPredicate document_predicate) const;
-	template <typename DocumentPredicate>
-	std::vector<Document> FindAllDocuments(std::execution::sequenced_policy policy, const Query &query, DocumentPredicate document_predicate) const;
-	template <typename DocumentPredicate>
-	std::vector<Document> FindAllDocuments(std::execution::parallel_policy policy, const Query &query, DocumentPredicate document_predicate) const;
-};
+	private:
+		const SearchServer &server_;
+		WordRange words_;
+	};
+	const StopWordSet stop_words_;
 
-template <typename DocumentPredicate>
-[[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(std::execution::sequenced_policy policy, const std::string_view raw_query, DocumentPredicate document_predicate) const
-{
-	Query query = ParseQuery(raw_query);
+	TermDictionary terms_;
 
-	std::sort(query.plus_words.begin(), query.plus_words.end());
-	auto last_plus = std::unique(query.plus_words.begin(), query.plus_words.end());
-	query.plus_words.erase(last_plus, query.plus_words.end());
+	std::vector<PostingList> term_to_document_freqs_;
+	// live documents per term, the posting lists also count tombstones
+	std::vector<uint32_t> term_document_counts_;
+	// largest term_freq in every posting list, tombstones included, so it never
+	// understates a live document
+	std::vector<double> term_max_freqs_;
+	IdfCache idf_cache_;
+	std::map<int, std::map<TermId, uint32_t>> document_to_term_counts_;
 
-	std::sort(query.minus_words.begin(), query.minus_words.end());
-	auto last_minus = std::unique(query.minus_words.begin(), query.minus_words.end());
-	query.minus_words.erase(last_minus, query.minus_words.end());
+	std::map<int, DocumentData> documents_;
+	std::set<int> document_ids_;
+	std::vector<int> ordinal_to_document_id_;
+	std::vector<bool> removed_ordinals_;
+	// dense columns by ordinal for predicates and status filters, removed documents keep their values
+	std::vector<int> ordinal_ratings_;
+	std::vector<DocumentStatus> ordinal_statuses_;
+	// document lengths in words that are not stop words, postings hold counts and the
+	// inverse length turns them into term frequencies
+	std::vector<uint32_t> ordinal_word_counts_;
+	std::vector<double> ordinal_inverse_word_counts_;
+	// live documents of every status, a search by a status none of them has skips scoring
+	static constexpr size_t STATUS_COUNT = static_cast<size_t>(DocumentStatus::REMOVED) + 1;
+	std::array<CompressedBitmap, STATUS_COUNT> status_documents_;
+	size_t removed_posting_count_ = 0;
+
+	std::shared_ptr<const MappedFile> index_file_;
+
+	// bumped by every change of the index, prepared queries remember the value they saw
+	uint64_t generation_ = 0;
+	QueryResultCache result_cache_;
+	std::shared_ptr<ThreadPool> thread_pool_;
+
+	[[nodiscard]] bool IsStopWord(const std::string_view word) const;
+
+	static bool IsValidWord(const std::string_view word);
+
+	[[nodiscard]] DocumentWordRange SplitIntoWordsNoStop(const std::string_view text) const;
+
+	void AddDocumentBatch(std::execution::sequenced_policy policy, const std::vector<const RawDocument *> &documents);
+	void AddDocumentBatch(std::execution::parallel_policy policy, const std::vector<const RawDocument *> &documents);
+	void CheckNewDocuments(const std::vector<const RawDocument *> &documents) const;
+	void BuildPartialIndex(const std::vector<const RawDocument *> &documents, size_t first, size_t last, PartialIndex &partial_index) const;
+	void MergePartialIndexes(const std::vector<const RawDocument *> &documents, std::vector<PartialIndex> &partial_indexes);
+
+	void CheckPreparedQuery(const PreparedQuery &query) const;
+	[[nodiscard]] QueryWord ParseQueryWord(const std::string_view text) const;
+	// Resolves the words of raw_query to sorted unique term ids, without weights
+	[[nodiscard]] PreparedQuery ParseQuery(const std::string_view raw_query) const;
+	// Sets the pruning order and bounds of a query whose plus terms have their idf,
+	// document_freqs are those of the plus terms, in the same order
+	void SetPruningOrder(PreparedQuery &query, const std::vector<int> &document_freqs) const;
 
-	auto matched_documents = FindAllDocuments(query, document_predicate);
+	static ScoreAccumulator &GetThreadScoreAccumulator();
+	// Marks the documents that contain a minus term of the query, so scoring can skip
+	// them; returns nullptr without touching the bitmap if the query has no minus terms
+	[[nodiscard]] const DocumentBitmap *FindExcludedDocuments(const PreparedQuery &query, DocumentBitmap &excluded_documents) const;
 
-	sort(matched_documents.begin(), matched_documents.end(), [](const Document &lhs, const Document &rhs)
-		 {
-			if (std::abs(lhs.relevance - rhs.relevance) < precision) {
-				return lhs.rating > rhs.rating;
-			}
-			else {
-				return lhs.relevance > rhs.relevance;
-			} });
+	[[nodiscard]] static int ComputeAverageRating(const std::vector<int> &ratings);
+	[[nodiscard]] double ComputeTermInverseDocumentFreq(TermId term_id) const;
+	void AppendDocument(int document_id, int rating, DocumentStatus status, uint32_t word_count, std::vector<TermId> terms);
+	// Every term_freq of the index is computed here, so the MaxScore bounds hold bit for bit
+	[[nodiscard]] static double ComputeTermFreq(uint32_t count, double inverse_word_count)
+	{
+		return count * inverse_word_count;
+	}
+	void RemoveDocumentTerms(const DocumentData &document_data);
+	// The status filter of every posting: reads the dense columns, which cost a load each,
+	// where the bitmap of the status would need a search in its sparse chunks
+	[[nodiscard]] bool IsLiveWithStatus(DocumentOrdinal ordinal, DocumentStatus status) const
+	{
+		return ordinal_statuses_[ordinal] == status && !removed_ordinals_[ordinal];
+	}
+
+	// FindTopDocuments by status through the result cache
+	template <typename ExecutionPolicy>
+	std::vector<Document> FindTopDocumentsCached(ExecutionPolicy policy, const PreparedQuery &query, DocumentStatus status, size_t top_count) const;
+	template <typename OrdinalFilter>
+	std::future<std::vector<Document>> FindTopDocumentsAsyncFiltered(std::string raw_query, OrdinalFilter ordinal_filter, size_t top_count, std::optional<DocumentStatus> cached_status) const;
+	// the stages of FindTopDocumentsAsync, each one posts the next
+	template <typename OrdinalFilter>
+	void PrepareAsyncSearch(const std::shared_ptr<AsyncSearch<OrdinalFilter>> &search) const;
+	template <typename OrdinalFilter>
+	void ScoreAsyncSearchChunk(const std::shared_ptr<AsyncSearch<OrdinalFilter>> &search, size_t chunk) const;
+	template <typename OrdinalFilter>
+	void MergeAsyncSearch(AsyncSearch<OrdinalFilter> &search) const;
+	template <typename ExecutionPolicy, typename OrdinalFilter>
+	std::vector<Document> FindTopDocumentsFiltered(ExecutionPolicy policy, const PreparedQuery &query, OrdinalFilter ordinal_filter, size_t top_count) const;
+
+	// FindAllDocuments scores every matching document whose ordinal passes ordinal_filter
+	// and feeds it into top_documents. The filter must reject removed documents.
+	template <typename OrdinalFilter>
+	void FindAllDocuments(const PreparedQuery &query, OrdinalFilter ordinal_filter, TopDocuments &top_documents) const;
+	template <typename OrdinalFilter>
+	void FindAllDocuments(std::execution::sequenced_policy policy, const PreparedQuery &query, OrdinalFilter ordinal_filter, TopDocuments &top_documents) const;
+	template <typename OrdinalFilter>
+	void FindAllDocuments(std::execution::parallel_policy policy, const PreparedQuery &query, OrdinalFilter ordinal_filter, TopDocuments &top_documents) const;
+	// Scores the documents of ordinals [first, last) with MaxScore pruning, see the definition
+	template <typename OrdinalFilter>
+	void ScoreDocumentRange(const PreparedQuery &query, OrdinalFilter ordinal_filter, const DocumentBitmap *excluded_documents,
+							DocumentOrdinal first, DocumentOrdinal last, TopDocuments &top_documents) const;
+};
+
+template <typename DocumentRange>
+void SearchServer::AddDocuments(std::execution::sequenced_policy policy, const DocumentRange &documents)
+{
+	std::vector<const RawDocument *> batch;
+	for (const RawDocument &document : documents)
+	{
+		batch.push_back(&document);
+	}
+	AddDocumentBatch(std::execution::seq, batch);
+}
 
-	if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT)
+template <typename DocumentRange>
+void SearchServer::AddDocuments(std::execution::parallel_policy policy, const DocumentRange &documents)
+{
+	std::vector<const RawDocument *> batch;
+	for (const RawDocument &document : documents)
 	{
-		matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+		batch.push_back(&document);
 	}
+	AddDocumentBatch(std::execution::par, batch);
+}
 
-	return matched_documents;
+template <typename DocumentRange>
+void SearchServer::AddDocuments(const DocumentRange &documents)
+{
+	AddDocuments(std::execution::seq, documents);
 }
 
 template <typename DocumentPredicate>
-[[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const
+[[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(std::execution::sequenced_policy policy, const std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count) const
 {
-	return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+	return FindTopDocuments(std::execution::seq, PrepareQuery(raw_query), document_predicate, top_count);
 }
 
 template <typename DocumentPredicate>
-[[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(std::execution::parallel_policy policy, const std::string_view raw_query, DocumentPredicate document_predicate) const
+[[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count) const
 {
-	Query query = ParseQuery(raw_query);
+	return FindTopDocuments(std::execution::seq, raw_query, document_predicate, top_count);
+}
 
-	auto sort_plus = std::async([&query]
-								{ std::sort(query.plus_words.begin(), query.plus_words.end()); });
-	auto sort_minus = std::async([&query]
-								 { std::sort(query.minus_words.begin(), query.minus_words.end()); });
+template <typename DocumentPredicate>
+[[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(std::execution::parallel_policy policy, const std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count) const
+{
+	return FindTopDocuments(std::execution::par, PrepareQuery(raw_query), document_predicate, top_count);
+}
 
-	sort_plus.get();
+template <typename DocumentPredicate>
+[[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(std::execution::sequenced_policy policy, const PreparedQuery &query, DocumentPredicate document_predicate, size_t top_count) const
+{
+	const auto predicate_filter = [this, &document_predicate](DocumentOrdinal ordinal)
+	{
+		return !removed_ordinals_[ordinal] && document_predicate(ordinal_to_document_id_[ordinal], ordinal_statuses_[ordinal], ordinal_ratings_[ordinal]);
+	};
+	return FindTopDocumentsFiltered(std::execution::seq, query, predicate_filter, top_count);
+}
 
-	auto last_plus = std::unique(query.plus_words.begin(), query.plus_words.end());
-	query.plus_words.erase(last_plus, query.plus_words.end());
+template <typename DocumentPredicate>
+[[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery &query, DocumentPredicate document_predicate, size_t top_count) const
+{
+	return FindTopDocuments(std::execution::seq, query, document_predicate, top_count);
+}
 
-	sort_minus.get();
+template <typename DocumentPredicate>
+[[nodiscard]] std::vector<Document> SearchServer::FindTopDocuments(std::execution::parallel_policy policy, const PreparedQuery &query, DocumentPredicate document_predicate, size_t top_count) const
+{
+	const auto predicate_filter = [this, &document_predicate](DocumentOrdinal ordinal)
+	{
+		return !removed_ordinals_[ordinal] && document_predicate(ordinal_to_document_id_[ordinal], ordinal_statuses_[ordinal], ordinal_ratings_[ordinal]);
+	};
+	return FindTopDocumentsFiltered(std::execution::par, query, predicate_filter, top_count);
+}
 
-	auto last_minus = std::unique(query.minus_words.begin(), query.minus_words.end());
-	query.minus_words.erase(last_minus, query.minus_words.end());
+template <typename DocumentPredicate>
+std::future<std::vector<Document>> SearchServer::FindTopDocumentsAsync(std::string raw_query, DocumentPredicate document_predicate, size_t top_count) const
+{
+	// the filter outlives the call, so it owns its copy of the predicate
+	auto predicate_filter = [this, document_predicate](DocumentOrdinal ordinal)
+	{
+		return !removed_ordinals_[ordinal] && document_predicate(ordinal_to_document_id_[ordinal], ordinal_statuses_[ordinal], ordinal_ratings_[ordinal]);
+	};
+	return FindTopDocumentsAsyncFiltered(std::move(raw_query), std::move(predicate_filter), top_count, std::nullopt);
+}
 
-	auto matched_documents = FindAllDocuments(std::execution::par, query, document_predicate);
+template <typename OrdinalFilter>
+std::future<std::vector<Document>> SearchServer::FindTopDocumentsAsyncFiltered(std::string raw_query, OrdinalFilter ordinal_filter, size_t top_count, std::optional<DocumentStatus> cached_status) const
+{
+	auto search = std::make_shared<AsyncSearch<OrdinalFilter>>(std::move(raw_query), std::move(ordinal_filter), top_count, cached_status);
+	auto future = search->result.get_future();
+	GetThreadPool().Post([this, search]
+						 { PrepareAsyncSearch(search); });
+	return future;
+}
 
-	sort(matched_documents.begin(), matched_documents.end(), [](const Document &lhs, const Document &rhs)
-		 {
-			if (std::abs(lhs.relevance - rhs.relevance) < precision) {
-				return lhs.rating > rhs.rating;
+template <typename OrdinalFilter>
+void SearchServer::PrepareAsyncSearch(const std::shared_ptr<AsyncSearch<OrdinalFilter>> &search) const
+{
+	// below this many documents per task the scoring is cheaper than handing it over
+	static constexpr size_t MIN_CHUNK_SIZE = 16384;
+	try
+	{
+		search->query = PrepareQuery(search->raw_query);
+		if (search->cached_status && result_cache_.IsEnabled())
+		{
+			const QueryCacheKey key{search->query.plus_terms_, search->query.minus_terms_, *search->cached_status, search->top_count};
+			if (auto documents = result_cache_.Find(key, generation_))
+			{
+				search->result.set_value(std::move(*documents));
+				return;
 			}
-			else {
-				return lhs.relevance > rhs.relevance;
-			} });
-
-	if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT)
+		}
+		search->excluded_documents = FindExcludedDocuments(search->query, search->excluded_documents_buffer);
+
+		const size_t document_count = ordinal_to_document_id_.size();
+		ThreadPool &thread_pool = GetThreadPool();
+		const size_t chunk_count = std::max<size_t>(1, std::min(thread_pool.GetThreadCount(), document_count / MIN_CHUNK_SIZE));
+		search->chunk_size = (document_count + chunk_count - 1) / chunk_count;
+		search->chunk_tops.assign(chunk_count, TopDocuments(search->top_count));
+		search->pending_chunk_count.store(chunk_count, std::memory_order_relaxed);
+		// the first chunk is scored by this task, the others are left to idle workers
+		for (size_t chunk = 1; chunk < chunk_count; ++chunk)
+		{
+			thread_pool.Post([this, search, chunk]
+							 { ScoreAsyncSearchChunk(search, chunk); });
+		}
+	}
+	catch (...)
 	{
-		matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+		search->result.set_exception(std::current_exception());
+		return;
 	}
-
-	return matched_documents;
+	ScoreAsyncSearchChunk(search, 0);
 }
 
-template <typename DocumentPredicate>
-[[nodiscard]] std::vector<Document> SearchServer::FindAllDocuments(std::execution::sequenced_policy policy, const Query &query, DocumentPredicate document_predicate) const
+template <typename OrdinalFilter>
+void SearchServer::ScoreAsyncSearchChunk(const std::shared_ptr<AsyncSearch<OrdinalFilter>> &search, size_t chunk) const
 {
-	std::map<int, double> document_to_relevance;
-
-	for (const std::string_view word : query.plus_words)
+	const size_t document_count = ordinal_to_document_id_.size();
+	const auto first = static_cast<DocumentOrdinal>(std::min(chunk * search->chunk_size, document_count));
+	const auto last = static_cast<DocumentOrdinal>(std::min(first + search->chunk_size, document_count));
+	try
 	{
-		if (word_to_document_freqs_.count(word) == 0)
+		if (first != last)
 		{
-			continue;
+			ScoreDocumentRange(search->query, search->ordinal_filter, search->excluded_documents, first, last, search->chunk_tops[chunk]);
 		}
-		const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-
-		for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word))
+	}
+	catch (...)
+	{
+		std::lock_guard guard(search->error_mutex);
+		if (!search->error)
 		{
-			const auto &document_data = documents_.at(document_id);
-			if (document_predicate(document_id, document_data.status, document_data.rating))
-			{
-				document_to_relevance[document_id] += term_freq * inverse_document_freq;
-			}
+			search->error = std::current_exception();
 		}
 	}
+	// whoever scores the last chunk merges, the release makes every chunk result visible to it
+	if (search->pending_chunk_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		MergeAsyncSearch(*search);
+	}
+}
 
-	for (const std::string_view word : query.minus_words)
+template <typename OrdinalFilter>
+void SearchServer::MergeAsyncSearch(AsyncSearch<OrdinalFilter> &search) const
+{
+	if (search.error)
+	{
+		search.result.set_exception(search.error);
+		return;
+	}
+	try
 	{
-		if (word_to_document_freqs_.count(word) == 0)
+		TopDocuments top_documents(search.top_count);
+		for (const TopDocuments &chunk_top : search.chunk_tops)
 		{
-			continue;
+			top_documents.Merge(chunk_top);
 		}
-		for (const auto [document_id, _] : word_to_document_freqs_.at(word))
+		auto documents = std::move(top_documents).Extract();
+		if (search.cached_status && result_cache_.IsEnabled())
 		{
-			document_to_relevance.erase(document_id);
+			result_cache_.Insert({search.query.plus_terms_, search.query.minus_terms_, *search.cached_status, search.top_count}, generation_, documents);
 		}
+		search.result.set_value(std::move(documents));
+	}
+	catch (...)
+	{
+		search.result.set_exception(std::current_exception());
+	}
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocumentsCached(ExecutionPolicy policy, const PreparedQuery &query, DocumentStatus status, size_t top_count) const
+{
+	const auto status_index = static_cast<size_t>(status);
+	// no live document has the status, there is nothing to score
+	if (status_index >= STATUS_COUNT || status_documents_[status_index].size() == 0)
+	{
+		CheckPreparedQuery(query);
+		return {};
+	}
+	const auto status_filter = [this, status](DocumentOrdinal ordinal)
+	{
+		return IsLiveWithStatus(ordinal, status);
+	};
+	if (!result_cache_.IsEnabled() || query.has_collection_statistics_)
+	{
+		return FindTopDocumentsFiltered(policy, query, status_filter, top_count);
 	}
 
-	std::vector<Document> matched_documents;
-	for (const auto [document_id, relevance] : document_to_relevance)
+	CheckPreparedQuery(query);
+	const QueryCacheKey key{query.plus_terms_, query.minus_terms_, status, top_count};
+	if (auto documents = result_cache_.Find(key, generation_))
 	{
-		matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
+		return std::move(*documents);
 	}
-	return matched_documents;
+	auto documents = FindTopDocumentsFiltered(policy, query, status_filter, top_count);
+	result_cache_.Insert(key, generation_, documents);
+	return documents;
 }
 
-template <typename DocumentPredicate>
-[[nodiscard]] std::vector<Document> SearchServer::FindAllDocuments(const Query &query, DocumentPredicate document_predicate) const
+template <typename ExecutionPolicy, typename OrdinalFilter>
+std::vector<Document> SearchServer::FindTopDocumentsFiltered(ExecutionPolicy policy, const PreparedQuery &query, OrdinalFilter ordinal_filter, size_t top_count) const
+{
+	CheckPreparedQuery(query);
+
+	TopDocuments top_documents(top_count);
+	FindAllDocuments(policy, query, ordinal_filter, top_documents);
+
+	return std::move(top_documents).Extract();
+}
+
+template <typename OrdinalFilter>
+void SearchServer::FindAllDocuments(std::execution::sequenced_policy policy, const PreparedQuery &query, OrdinalFilter ordinal_filter, TopDocuments &top_documents) const
 {
-	return FindAllDocuments(std::execution::seq, query, document_predicate);
+	thread_local DocumentBitmap excluded_documents_buffer;
+	const DocumentBitmap *excluded_documents = FindExcludedDocuments(query, excluded_documents_buffer);
+
+	ScoreDocumentRange(query, ordinal_filter, excluded_documents, 0, static_cast<DocumentOrdinal>(ordinal_to_document_id_.size()), top_documents);
 }
 
-template <typename DocumentPredicate>
-[[nodiscard]] std::vector<Document> SearchServer::FindAllDocuments(std::execution::parallel_policy policy, const Query &query, DocumentPredicate document_predicate) const
+template <typename OrdinalFilter>
+void SearchServer::FindAllDocuments(const PreparedQuery &query, OrdinalFilter ordinal_filter, TopDocuments &top_documents) const
+{
+	FindAllDocuments(std::execution::seq, query, ordinal_filter, top_documents);
+}
+
+template <typename OrdinalFilter>
+void SearchServer::FindAllDocuments(std::execution::parallel_policy policy, const PreparedQuery &query, OrdinalFilter ordinal_filter, TopDocuments &top_documents) const
+{
+	// built once by the calling thread, the workers only read it. It is not thread_local:
+	// while waiting for the workers this thread may run another query.
+	DocumentBitmap excluded_documents_buffer;
+	const DocumentBitmap *excluded_documents = FindExcludedDocuments(query, excluded_documents_buffer);
+
+	// the ordinal space is split into disjoint ranges, every worker scores its range
+	// with its own accumulator and collector, so no posting update needs a lock
+	ThreadPool &thread_pool = GetThreadPool();
+	const size_t document_count = ordinal_to_document_id_.size();
+	const size_t chunk_count = std::max<size_t>(1, thread_pool.GetThreadCount());
+	const size_t chunk_size = (document_count + chunk_count - 1) / chunk_count;
+	std::vector<TopDocuments> chunk_tops(chunk_count, TopDocuments(top_documents.capacity()));
+
+	thread_pool.ParallelFor(chunk_count,
+							[&](size_t chunk)
+							{
+								const auto first = static_cast<DocumentOrdinal>(std::min(chunk * chunk_size, document_count));
+								const auto last = static_cast<DocumentOrdinal>(std::min(first + chunk_size, document_count));
+								if (first == last)
+								{
+									return;
+								}
+
+								ScoreDocumentRange(query, ordinal_filter, excluded_documents, first, last, chunk_tops[chunk]);
+							});
+
+	for (const TopDocuments &chunk_top : chunk_tops)
+	{
+		top_documents.Merge(chunk_top);
+	}
+}
+
+// MaxScore (Turtle and Flood): once the collector is full, a document has to reach its
+// admission threshold. The first terms of the pruning order whose bounds together stay
+// below the threshold are non-essential: a document containing only them cannot be
+// collected. The range is scored window by window. Essential terms are scanned into the
+// accumulator. Non-essential ones are only probed, for documents whose score plus the
+// bounds of the terms not probed yet still reaches the threshold. The set of
+// non-essential terms is chosen again after every window.
+// Scanned or probed, terms are added up from the last one of the pruning order to the
+// first, so the relevance of a document does not depend on how much was pruned.
+template <typename OrdinalFilter>
+void SearchServer::ScoreDocumentRange(const PreparedQuery &query, OrdinalFilter ordinal_filter, const DocumentBitmap *excluded_documents,
+									  DocumentOrdinal first, DocumentOrdinal last, TopDocuments &top_documents) const
 {
-	ConcurrentMap<int, double> document_to_relevance(100);
-
-	std::vector<std::string> plus_words{query.plus_words.begin(), query.plus_words.end()};
-	std::vector<std::string> minus_words{query.minus_words.begin(), query.minus_words.end()};
-
-	for_each(std::execution::par,
-			 plus_words.begin(), plus_words.end(),
-			 [&document_to_relevance, this, &document_predicate, &query, &minus_words](std::string_view word)
-			 {
-				 auto contain_minus = std::any_of(std::execution::par,
-												  minus_words.begin(), minus_words.end(),
-												  [&word](const auto &minus_word)
-												  {
-													  return minus_word == word;
-												  });
-
-				 if (word_to_document_freqs_.count(word) && !contain_minus)
-				 {
-					 const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-					 std::for_each(std::execution::par,
-								   word_to_document_freqs_.at(std::string(word)).begin(), word_to_document_freqs_.at(std::string(word)).end(),
-								   [this, &document_to_relevance, &inverse_document_freq, &document_predicate](const auto &doc_freq)
-								   {
-									   const auto &document_data = documents_.at(doc_freq.first);
-									   if (document_predicate(doc_freq.first, document_data.status, document_data.rating))
-									   {
-										   document_to_relevance[doc_freq.first].ref_to_value += doc_freq.second * inverse_document_freq;
-									   }
-								   });
-				 }
-			 });
-
-	std::atomic_int size = 0;
-	const std::map<int, double> &ord_map = document_to_relevance.BuildOrdinaryMap();
-	std::vector<Document> matched_documents(ord_map.size());
-
-	std::for_each(std::execution::par,
-				  ord_map.begin(), ord_map.end(),
-				  [&matched_documents, this, &size](const auto &map)
-				  {
-					  int document_id = map.first;
-					  double relevance = map.second;
-					  matched_documents[size++] = {document_id, relevance, documents_.at(document_id).rating};
-				  });
-
-	matched_documents.resize(size);
-
-	return matched_documents;
-}
\ No newline at end of file
+	// small enough for the threshold to rise early, large enough to amortize the per-term work
+	static constexpr DocumentOrdinal WINDOW_SIZE = 4096;
+	// postings a probe of a document is worth, see the choice of the non-essential terms
+	static constexpr size_t PROBE_COST = 2;
+	// a document that ties the threshold within precision may still win by its rating,
+	// so bounds are compared with a margin well above precision
+	const double pruning_margin = 16 * precision;
+
+	const size_t term_count = query.plus_terms_.size();
+	ScoreAccumulator &document_to_relevance = GetThreadScoreAccumulator();
+
+	// a cursor for every plus term in pruning order, at its first posting past the last window
+	std::vector<PostingList::Cursor> cursors;
+	cursors.reserve(term_count);
+	for (size_t k = 0; k < term_count; ++k)
+	{
+		cursors.emplace_back(term_to_document_freqs_[query.plus_terms_[query.pruning_order_[k]]]);
+		cursors.back().Seek(first);
+	}
+	// positions of the postings of every term inside the current window
+	std::vector<size_t> window_begins(term_count);
+	std::vector<size_t> window_ends(term_count);
+	size_t non_essential_count = 0;
+	std::array<uint64_t, WINDOW_SIZE / 64> window_documents;
+
+	for (DocumentOrdinal window_first = first; window_first < last;)
+	{
+		const DocumentOrdinal window_last = last - window_first > WINDOW_SIZE ? window_first + WINDOW_SIZE : last;
+		document_to_relevance.Reset(ordinal_to_document_id_.size());
+
+		for (size_t k = term_count; k-- > 0;)
+		{
+			PostingList::Cursor &cursor = cursors[k];
+			window_begins[k] = cursor.GetPosition();
+			// non-essential terms are probed below and then moved past the window
+			if (k < non_essential_count)
+			{
+				continue;
+			}
+			const double inverse_document_freq = query.inverse_document_freqs_[query.pruning_order_[k]];
+			cursor.ForEachBefore(window_last,
+								 [&](DocumentOrdinal document_ordinal, uint32_t count)
+								 {
+									 if ((excluded_documents && excluded_documents->Test(document_ordinal)) || !ordinal_filter(document_ordinal))
+									 {
+										 return;
+									 }
+									 const double term_freq = ComputeTermFreq(count, ordinal_inverse_word_counts_[document_ordinal]);
+									 document_to_relevance.Add(document_ordinal, term_freq * inverse_document_freq);
+								 });
+		}
+
+		const auto collect_document = [&](DocumentOrdinal document_ordinal)
+		{
+			double relevance = document_to_relevance.Get(document_ordinal);
+			size_t k = non_essential_count;
+			while (k > 0 && relevance + query.pruning_bound_sums_[k] >= top_documents.GetAdmissionThreshold() - pruning_margin)
+			{
+				--k;
+				PostingList::Cursor &cursor = cursors[k];
+				cursor.Seek(document_ordinal);
+				if (!cursor.IsAtEnd() && cursor.GetOrdinal() == document_ordinal)
+				{
+					const double term_freq = ComputeTermFreq(cursor.GetCount(), ordinal_inverse_word_counts_[document_ordinal]);
+					relevance += term_freq * query.inverse_document_freqs_[query.pruning_order_[k]];
+				}
+			}
+			if (k == 0)
+			{
+				top_documents.Add({ordinal_to_document_id_[document_ordinal], relevance, ordinal_ratings_[document_ordinal]});
+			}
+		};
+		if (non_essential_count == 0)
+		{
+			for (const DocumentOrdinal document_ordinal : document_to_relevance.GetTouched())
+			{
+				collect_document(document_ordinal);
+			}
+		}
+		else
+		{
+			// cursors only move forward, so the documents are visited in ordinal order
+			window_documents.fill(0);
+			for (const DocumentOrdinal document_ordinal : document_to_relevance.GetTouched())
+			{
+				const DocumentOrdinal offset = document_ordinal - window_first;
+				window_documents[offset / 64] |= uint64_t{1} << (offset % 64);
+			}
+			for (size_t word = 0; word < window_documents.size(); ++word)
+			{
+				for (uint64_t bits = window_documents[word]; bits != 0; bits &= bits - 1)
+				{
+					collect_document(static_cast<DocumentOrdinal>(window_first + word * 64 + CountTrailingZeros(bits)));
+				}
+			}
+		}
+		for (size_t k = 0; k < term_count; ++k)
+		{
+			if (k < non_essential_count)
+			{
+				cursors[k].Seek(window_last);
+			}
+			window_ends[k] = cursors[k].GetPosition();
+		}
+
+		const double threshold = top_documents.GetAdmissionThreshold() - pruning_margin;
+		size_t prunable_count = 0;
+		size_t prunable_posting_count = 0;
+		while (prunable_count < term_count && query.pruning_bound_sums_[prunable_count + 1] < threshold)
+		{
+			prunable_posting_count += window_ends[prunable_count] - window_begins[prunable_count];
+			++prunable_count;
+		}
+		// pruning pays off only if it skips more postings than the probes cost. Only documents
+		// of the essential terms are probed; the touched ones also count the documents of
+		// the prunable terms while these are scanned, so they alone would never allow pruning.
+		size_t essential_posting_count = 0;
+		for (size_t k = prunable_count; k < term_count; ++k)
+		{
+			essential_posting_count += window_ends[k] - window_begins[k];
+		}
+		const size_t probed_count = std::min(essential_posting_count, document_to_relevance.GetTouched().size());
+		non_essential_count = prunable_posting_count > PROBE_COST * probed_count ? prunable_count : 0;
+		window_first = window_last;
+	}
+}
@@ -0,0 +1,144 @@
+#include "search_shard.h"
+
+#include <execution>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+LocalSearchShard::LocalSearchShard(SearchServer search_server)
+	: search_server_(move(search_server))
+{
+}
+
+void LocalSearchShard::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int> &ratings)
+{
+	search_server_.AddDocument(document_id, document, status, ratings);
+}
+
+void LocalSearchShard::RemoveDocument(int document_id)
+{
+	search_server_.RemoveDocument(document_id);
+}
+
+int LocalSearchShard::GetDocumentCount() const
+{
+	return search_server_.GetDocumentCount();
+}
+
+CollectionStatistics LocalSearchShard::GetQueryStatistics(string_view raw_query) const
+{
+	return search_server_.GetQueryStatistics(raw_query);
+}
+
+vector<Document> LocalSearchShard::FindTopDocuments(string_view raw_query, const CollectionStatistics &statistics, DocumentStatus status, size_t top_count) const
+{
+	// the coordinator already runs the shards in parallel
+	return search_server_.FindTopDocuments(execution::seq, search_server_.PrepareQuery(raw_query, statistics), status, top_count);
+}
+
+const SearchServer &LocalSearchShard::GetSearchServer() const
+{
+	return search_server_;
+}
+
+RemoteSearchShard::RemoteSearchShard(const string &socket_path)
+	: socket_(ShardSocket::Connect(socket_path))
+{
+}
+
+void RemoteSearchShard::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int> &ratings)
+{
+	ShardMessageWriter request;
+	request.Write(ShardRequest::ADD_DOCUMENT);
+	request.Write(static_cast<int32_t>(document_id));
+	request.Write(static_cast<uint32_t>(status));
+	request.Write(document);
+	request.Write(static_cast<uint32_t>(ratings.size()));
+	for (const int rating : ratings)
+	{
+		request.Write(static_cast<int32_t>(rating));
+	}
+
+	lock_guard guard(mutex_);
+	string reply;
+	Call(request, reply);
+}
+
+void RemoteSearchShard::RemoveDocument(int document_id)
+{
+	ShardMessageWriter request;
+	request.Write(ShardRequest::REMOVE_DOCUMENT);
+	request.Write(static_cast<int32_t>(document_id));
+
+	lock_guard guard(mutex_);
+	string reply;
+	Call(request, reply);
+}
+
+int RemoteSearchShard::GetDocumentCount() const
+{
+	ShardMessageWriter request;
+	request.Write(ShardRequest::GET_DOCUMENT_COUNT);
+
+	lock_guard guard(mutex_);
+	string reply;
+	return Call(request, reply).Read<int32_t>();
+}
+
+CollectionStatistics RemoteSearchShard::GetQueryStatistics(string_view raw_query) const
+{
+	ShardMessageWriter request;
+	request.Write(ShardRequest::GET_QUERY_STATISTICS);
+	request.Write(raw_query);
+
+	lock_guard guard(mutex_);
+	string reply;
+	return Call(request, reply).ReadStatistics();
+}
+
+vector<Document> RemoteSearchShard::FindTopDocuments(string_view raw_query, const CollectionStatistics &statistics, DocumentStatus status, size_t top_count) const
+{
+	ShardMessageWriter request;
+	request.Write(ShardRequest::FIND_TOP_DOCUMENTS);
+	request.Write(raw_query);
+	request.Write(statistics);
+	request.Write(static_cast<uint32_t>(status));
+	request.Write(static_cast<uint64_t>(top_count));
+
+	lock_guard guard(mutex_);
+	string reply;
+	ShardMessageReader reader = Call(request, reply);
+	const auto document_count = reader.Read<uint32_t>();
+	if (document_count > top_count)
+	{
+		throw runtime_error("Shard message is corrupted"s);
+	}
+	vector<Document> documents;
+	documents.reserve(document_count);
+	for (uint32_t i = 0; i < document_count; ++i)
+	{
+		documents.push_back(reader.ReadDocument());
+	}
+	return documents;
+}
+
+ShardMessageReader RemoteSearchShard::Call(const ShardMessageWriter &request, string &reply) const
+{
+	socket_.Send(request.GetBytes());
+	if (!socket_.Receive(reply))
+	{
+		throw runtime_error("Shard closed the connection"s);
+	}
+
+	ShardMessageReader reader(reply);
+	switch (reader.Read<ShardReply>())
+	{
+	case ShardReply::OK:
+		return reader;
+	case ShardReply::INVALID_ARGUMENT:
+		throw invalid_argument(string(reader.ReadString()));
+	default:
+		throw runtime_error("Shard failed: "s + string(reader.ReadString()));
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "search_server.h"
+#include "shard_protocol.h"
+
+// Part of a collection split over several indexes, searched by ShardedSearchServer.
+// A query reaches a shard twice: GetQueryStatistics gathers its counts, and FindTopDocuments
+// scores its documents with the counts summed over all shards.
+class SearchShard
+{
+public:
+	virtual ~SearchShard() = default;
+
+	virtual void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int> &ratings) = 0;
+	virtual void RemoveDocument(int document_id) = 0;
+	[[nodiscard]] virtual int GetDocumentCount() const = 0;
+
+	[[nodiscard]] virtual CollectionStatistics GetQueryStatistics(std::string_view raw_query) const = 0;
+	[[nodiscard]] virtual std::vector<Document> FindTopDocuments(std::string_view raw_query, const CollectionStatistics &statistics,
+																 DocumentStatus status, size_t top_count) const = 0;
+};
+
+// Shard held by this process
+class LocalSearchShard : public SearchShard
+{
+public:
+	explicit LocalSearchShard(SearchServer search_server);
+
+	void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int> &ratings) override;
+	void RemoveDocument(int document_id) override;
+	[[nodiscard]] int GetDocumentCount() const override;
+
+	[[nodiscard]] CollectionStatistics GetQueryStatistics(std::string_view raw_query) const override;
+	[[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query, const CollectionStatistics &statistics,
+														 DocumentStatus status, size_t top_count) const override;
+
+	[[nodiscard]] const SearchServer &GetSearchServer() const;
+
+private:
+	SearchServer search_server_;
+};
+
+// Shard served by a ShardServer, reached over one connection to its Unix domain socket.
+// Errors of the shard are rethrown: std::invalid_argument as such, others and failures
+// of the connection as std::runtime_error. Calls from several threads take turns.
+class RemoteSearchShard : public SearchShard
+{
+public:
+	explicit RemoteSearchShard(const std::string &socket_path);
+
+	void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int> &ratings) override;
+	void RemoveDocument(int document_id) override;
+	[[nodiscard]] int GetDocumentCount() const override;
+
+	[[nodiscard]] CollectionStatistics GetQueryStatistics(std::string_view raw_query) const override;
+	[[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query, const CollectionStatistics &statistics,
+														 DocumentStatus status, size_t top_count) const override;
+
+private:
+	mutable std::mutex mutex_;
+	ShardSocket socket_;
+
+	// Sends request and receives the reply into reply, returns a reader of the fields after
+	// its ShardReply; a failed request throws
+	ShardMessageReader Call(const ShardMessageWriter &request, std::string &reply) const;
+};
@@ -0,0 +1,237 @@
+#include "segmented_search_server.h"
+
+using namespace std;
+
+int SegmentedSearchServer::Segment::GetLiveDocumentCount() const
+{
+	return index.GetDocumentCount() - static_cast<int>(removed_document_ids.size());
+}
+
+SegmentedSearchServer::SegmentedSearchServer(const SearchServer &empty_index, SegmentMergePolicy policy)
+	: empty_index_(empty_index), policy_(policy), mutable_segment_(make_unique<SearchServer>(empty_index))
+{
+	if (empty_index_.GetDocumentCount() > 0)
+	{
+		throw invalid_argument("Segments must start from an empty index"s);
+	}
+	if (policy_.seal_document_count == 0 || policy_.merge_factor < 2)
+	{
+		throw invalid_argument("Invalid segment merge policy"s);
+	}
+	merger_ = thread([this]
+					 { RunMerger(); });
+}
+
+SegmentedSearchServer::~SegmentedSearchServer()
+{
+	{
+		lock_guard guard(mutex_);
+		is_stopping_ = true;
+	}
+	merge_wanted_.notify_all();
+	merger_.join();
+}
+
+void SegmentedSearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int> &ratings)
+{
+	// ids of the sealed segments are checked here, the mutable segment checks the rest
+	if (document_ids_.count(document_id) > 0)
+	{
+		throw invalid_argument("Invalid document_id"s);
+	}
+	mutable_segment_->AddDocument(document_id, document, status, ratings);
+	document_ids_.insert(document_id);
+	if (static_cast<size_t>(mutable_segment_->GetDocumentCount()) >= policy_.seal_document_count)
+	{
+		Seal();
+	}
+}
+
+void SegmentedSearchServer::RemoveDocument(int document_id)
+{
+	if (document_ids_.erase(document_id) == 0)
+	{
+		return;
+	}
+	if (mutable_segment_->HasDocument(document_id))
+	{
+		mutable_segment_->RemoveDocument(document_id);
+		return;
+	}
+
+	lock_guard guard(mutex_);
+	for (const auto &segment : sealed_segments_)
+	{
+		// a sealed segment may still hold a tombstoned copy of a document added again later
+		if (segment->index.HasDocument(document_id) && segment->removed_document_ids.count(document_id) == 0)
+		{
+			AddTombstone(*segment, document_id);
+			break;
+		}
+	}
+	merge_wanted_.notify_one();
+}
+
+vector<Document> SegmentedSearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status, size_t top_count) const
+{
+	return FindTopDocumentsInSegments(raw_query, top_count,
+									  [status, top_count](const SearchServer &index, const PreparedQuery &query, const unordered_set<int> *removed_document_ids)
+									  {
+										  if (!removed_document_ids)
+										  {
+											  return index.FindTopDocuments(query, status, top_count);
+										  }
+										  return index.FindTopDocuments(
+											  query,
+											  [status, removed_document_ids](int document_id, DocumentStatus document_status, int)
+											  {
+												  return document_status == status && removed_document_ids->count(document_id) == 0;
+											  },
+											  top_count);
+									  });
+}
+
+vector<Document> SegmentedSearchServer::FindTopDocuments(string_view raw_query) const
+{
+	return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+int SegmentedSearchServer::GetDocumentCount() const
+{
+	return static_cast<int>(document_ids_.size());
+}
+
+size_t SegmentedSearchServer::GetSegmentCount() const
+{
+	lock_guard guard(mutex_);
+	return sealed_segments_.size();
+}
+
+void SegmentedSearchServer::Seal()
+{
+	if (mutable_segment_->GetDocumentCount() == 0)
+	{
+		return;
+	}
+	mutable_segment_->Compact();
+	auto segment = make_shared<Segment>(Segment{move(*mutable_segment_), {}, {}});
+	mutable_segment_ = make_unique<SearchServer>(empty_index_);
+	{
+		lock_guard guard(mutex_);
+		sealed_segments_.push_back(move(segment));
+	}
+	merge_wanted_.notify_one();
+}
+
+void SegmentedSearchServer::WaitForMerges() const
+{
+	unique_lock lock(mutex_);
+	merge_done_.wait(lock, [this]
+					 { return !is_merging_ && SelectMerge().sources.empty(); });
+}
+
+SegmentedSearchServer::Merge SegmentedSearchServer::SelectMerge() const
+{
+	Merge merge;
+	vector<vector<shared_ptr<Segment>>> tiers;
+	for (const auto &segment : sealed_segments_)
+	{
+		const size_t removed_count = segment->removed_document_ids.size();
+		if (removed_count > 0 && static_cast<double>(removed_count) >= policy_.max_removed_share * segment->index.GetDocumentCount())
+		{
+			merge.sources = {segment};
+			break;
+		}
+		const size_t tier = GetTier(segment->GetLiveDocumentCount());
+		if (tiers.size() <= tier)
+		{
+			tiers.resize(tier + 1);
+		}
+		tiers[tier].push_back(segment);
+		if (tiers[tier].size() == policy_.merge_factor)
+		{
+			merge.sources = move(tiers[tier]);
+			break;
+		}
+	}
+	for (const auto &segment : merge.sources)
+	{
+		merge.removed_document_ids.push_back(segment->removed_document_ids);
+	}
+	return merge;
+}
+
+size_t SegmentedSearchServer::GetTier(int document_count) const
+{
+	size_t tier = 0;
+	for (size_t bound = policy_.seal_document_count * policy_.merge_factor; static_cast<size_t>(document_count) >= bound; bound *= policy_.merge_factor)
+	{
+		++tier;
+	}
+	return tier;
+}
+
+void SegmentedSearchServer::RunMerger()
+{
+	unique_lock lock(mutex_);
+	while (true)
+	{
+		Merge merge;
+		merge_wanted_.wait(lock, [this, &merge]
+						   {
+							   if (is_stopping_)
+							   {
+								   return true;
+							   }
+							   merge = SelectMerge();
+							   return !merge.sources.empty(); });
+		if (is_stopping_)
+		{
+			return;
+		}
+		is_merging_ = true;
+
+		// sealed indexes never change, so they are read without the lock
+		lock.unlock();
+		auto merged = make_shared<Segment>(Segment{empty_index_, {}, {}});
+		for (size_t i = 0; i < merge.sources.size(); ++i)
+		{
+			merged->index.AppendIndex(merge.sources[i]->index, merge.removed_document_ids[i]);
+		}
+		lock.lock();
+
+		// documents removed while merging become tombstones of the merged segment
+		for (size_t i = 0; i < merge.sources.size(); ++i)
+		{
+			for (const int document_id : merge.sources[i]->removed_document_ids)
+			{
+				if (merge.removed_document_ids[i].count(document_id) == 0)
+				{
+					AddTombstone(*merged, document_id);
+				}
+			}
+		}
+		const auto position = find(sealed_segments_.begin(), sealed_segments_.end(), merge.sources.front()) - sealed_segments_.begin();
+		sealed_segments_.erase(remove_if(sealed_segments_.begin(), sealed_segments_.end(),
+										 [&merge](const shared_ptr<Segment> &segment)
+										 {
+											 return find(merge.sources.begin(), merge.sources.end(), segment) != merge.sources.end();
+										 }),
+							   sealed_segments_.end());
+		if (merged->GetLiveDocumentCount() > 0)
+		{
+			sealed_segments_.insert(sealed_segments_.begin() + position, move(merged));
+		}
+		is_merging_ = false;
+		merge_done_.notify_all();
+	}
+}
+
+void SegmentedSearchServer::AddTombstone(Segment &segment, int document_id)
+{
+	segment.removed_document_ids.insert(document_id);
+	for (const auto &[word, _] : segment.index.GetWordFrequencies(document_id))
+	{
+		++segment.removed_word_counts[word];
+	}
+}
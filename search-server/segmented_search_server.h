@@ -0,0 +1,161 @@
+#pragma once
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "search_server.h"
+
+struct SegmentMergePolicy
+{
+	// documents of the mutable segment at which it is sealed
+	size_t seal_document_count = 4096;
+	// tier i holds the sealed segments of up to seal_document_count * merge_factor^(i + 1)
+	// live documents; merge_factor segments of one tier are merged into one of the next
+	size_t merge_factor = 4;
+	// a sealed segment with this share of removed documents is rewritten on its own
+	double max_removed_share = 0.5;
+};
+
+// Index split into segments for fast ingestion. New documents go to a small mutable
+// segment, which is compacted and sealed once it reaches seal_document_count documents.
+// Sealed segments never change: removing one of their documents leaves a tombstone next
+// to the segment. A background thread merges sealed segments with a tiered policy and
+// drops the tombstones of the segments it merges.
+// Every segment is scored with the document counts of the whole index, so results match
+// those of a single SearchServer holding the same documents.
+// Like SearchServer, queries must not run concurrently with AddDocument or RemoveDocument;
+// the merges are synchronized internally.
+class SegmentedSearchServer
+{
+public:
+	// Segments are copies of empty_index, so they share its stop words and thread pool
+	explicit SegmentedSearchServer(const SearchServer &empty_index, SegmentMergePolicy policy = {});
+	SegmentedSearchServer(const SegmentedSearchServer &) = delete;
+	SegmentedSearchServer &operator=(const SegmentedSearchServer &) = delete;
+	~SegmentedSearchServer();
+
+	void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int> &ratings);
+	void RemoveDocument(int document_id);
+
+	template <typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	[[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	[[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+	[[nodiscard]] int GetDocumentCount() const;
+	// Sealed segments, the mutable one is not counted
+	[[nodiscard]] size_t GetSegmentCount() const;
+
+	// Seals the mutable segment now if it holds any document
+	void Seal();
+	// Returns once no merge is running or due
+	void WaitForMerges() const;
+
+private:
+	struct Segment
+	{
+		SearchServer index;
+		// tombstones of the sealed index and the number of them containing each word
+		std::unordered_set<int> removed_document_ids;
+		std::unordered_map<std::string_view, int> removed_word_counts;
+
+		[[nodiscard]] int GetLiveDocumentCount() const;
+	};
+	struct Merge
+	{
+		std::vector<std::shared_ptr<Segment>> sources;
+		// tombstones of the sources when the merge started, they are left out of the result
+		std::vector<std::unordered_set<int>> removed_document_ids;
+	};
+
+	const SearchServer empty_index_;
+	const SegmentMergePolicy policy_;
+	std::unique_ptr<SearchServer> mutable_segment_;
+	// live document ids of all segments
+	std::unordered_set<int> document_ids_;
+
+	// guards sealed_segments_ and the tombstones, which the merger reads
+	mutable std::mutex mutex_;
+	std::vector<std::shared_ptr<Segment>> sealed_segments_;
+	bool is_merging_ = false;
+	bool is_stopping_ = false;
+	std::condition_variable merge_wanted_;
+	mutable std::condition_variable merge_done_;
+	std::thread merger_;
+
+	// The segments to merge next or no sources if none is due, the mutex must be held
+	[[nodiscard]] Merge SelectMerge() const;
+	[[nodiscard]] size_t GetTier(int document_count) const;
+	void RunMerger();
+	static void AddTombstone(Segment &segment, int document_id);
+
+	template <typename SegmentFind>
+	std::vector<Document> FindTopDocumentsInSegments(std::string_view raw_query, size_t top_count, SegmentFind segment_find) const;
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count) const
+{
+	return FindTopDocumentsInSegments(raw_query, top_count,
+									  [&document_predicate, top_count](const SearchServer &index, const PreparedQuery &query, const std::unordered_set<int> *removed_document_ids)
+									  {
+										  if (!removed_document_ids)
+										  {
+											  return index.FindTopDocuments(query, document_predicate, top_count);
+										  }
+										  return index.FindTopDocuments(
+											  query,
+											  [&document_predicate, removed_document_ids](int document_id, DocumentStatus status, int rating)
+											  {
+												  return removed_document_ids->count(document_id) == 0 && document_predicate(document_id, status, rating);
+											  },
+											  top_count);
+									  });
+}
+
+template <typename SegmentFind>
+std::vector<Document> SegmentedSearchServer::FindTopDocumentsInSegments(std::string_view raw_query, size_t top_count, SegmentFind segment_find) const
+{
+	std::vector<std::shared_ptr<Segment>> sealed_segments;
+	{
+		std::lock_guard guard(mutex_);
+		sealed_segments = sealed_segments_;
+	}
+
+	// the counts of all segments, less the tombstones, make up the statistics of the index
+	CollectionStatistics statistics = mutable_segment_->GetQueryStatistics(raw_query);
+	for (const auto &segment : sealed_segments)
+	{
+		CollectionStatistics segment_statistics = segment->index.GetQueryStatistics(raw_query);
+		segment_statistics.document_count -= static_cast<int>(segment->removed_document_ids.size());
+		for (auto &[word, document_freq] : segment_statistics.document_freqs)
+		{
+			if (const auto it = segment->removed_word_counts.find(word); it != segment->removed_word_counts.end())
+			{
+				document_freq -= it->second;
+			}
+		}
+		statistics.Add(segment_statistics);
+	}
+
+	TopDocuments top_documents(top_count);
+	const auto add_documents = [&top_documents](const std::vector<Document> &documents)
+	{
+		for (const Document &document : documents)
+		{
+			top_documents.Add(document);
+		}
+	};
+	add_documents(segment_find(*mutable_segment_, mutable_segment_->PrepareQuery(raw_query, statistics), nullptr));
+	for (const auto &segment : sealed_segments)
+	{
+		const auto *removed_document_ids = segment->removed_document_ids.empty() ? nullptr : &segment->removed_document_ids;
+		add_documents(segment_find(segment->index, segment->index.PrepareQuery(raw_query, statistics), removed_document_ids));
+	}
+	return std::move(top_documents).Extract();
+}
@@ -0,0 +1,367 @@
+#include "shard_protocol.h"
+
+#include <cerrno>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define SEARCH_SERVER_HAS_UNIX_SOCKETS 1
+#endif
+
+using namespace std;
+
+void ShardMessageWriter::Write(string_view text)
+{
+	Write(static_cast<uint32_t>(text.size()));
+	message_.append(text);
+}
+
+void ShardMessageWriter::Write(const CollectionStatistics &statistics)
+{
+	Write(static_cast<int32_t>(statistics.document_count));
+	Write(static_cast<uint32_t>(statistics.document_freqs.size()));
+	for (const auto &[word, document_freq] : statistics.document_freqs)
+	{
+		Write(string_view(word));
+		Write(static_cast<int32_t>(document_freq));
+	}
+}
+
+void ShardMessageWriter::Write(const Document &document)
+{
+	Write(static_cast<int32_t>(document.id));
+	Write(document.relevance);
+	Write(static_cast<int32_t>(document.rating));
+}
+
+const string &ShardMessageWriter::GetBytes() const
+{
+	return message_;
+}
+
+ShardMessageReader::ShardMessageReader(string_view message)
+	: message_(message)
+{
+}
+
+string_view ShardMessageReader::ReadString()
+{
+	const auto size = Read<uint32_t>();
+	return {Take(size), size};
+}
+
+CollectionStatistics ShardMessageReader::ReadStatistics()
+{
+	CollectionStatistics statistics;
+	statistics.document_count = Read<int32_t>();
+	const auto word_count = Read<uint32_t>();
+	for (uint32_t i = 0; i < word_count; ++i)
+	{
+		const string_view word = ReadString();
+		statistics.document_freqs.emplace(word, Read<int32_t>());
+	}
+	return statistics;
+}
+
+Document ShardMessageReader::ReadDocument()
+{
+	const auto id = Read<int32_t>();
+	const auto relevance = Read<double>();
+	const auto rating = Read<int32_t>();
+	return {id, relevance, rating};
+}
+
+DocumentStatus ShardMessageReader::ReadStatus()
+{
+	const auto status = Read<uint32_t>();
+	if (status > static_cast<uint32_t>(DocumentStatus::REMOVED))
+	{
+		throw runtime_error("Shard message is corrupted"s);
+	}
+	return static_cast<DocumentStatus>(status);
+}
+
+const char *ShardMessageReader::Take(size_t size)
+{
+	if (size > message_.size())
+	{
+		throw runtime_error("Shard message is corrupted"s);
+	}
+	const char *data = message_.data();
+	message_.remove_prefix(size);
+	return data;
+}
+
+ShardSocket::ShardSocket(int descriptor)
+	: descriptor_(descriptor)
+{
+}
+
+ShardSocket::ShardSocket(ShardSocket &&other) noexcept
+	: descriptor_(exchange(other.descriptor_, -1))
+{
+}
+
+ShardSocket &ShardSocket::operator=(ShardSocket &&other) noexcept
+{
+	if (this != &other)
+	{
+		Close();
+		descriptor_ = exchange(other.descriptor_, -1);
+	}
+	return *this;
+}
+
+ShardSocket::~ShardSocket()
+{
+	Close();
+}
+
+int ShardSocket::GetDescriptor() const
+{
+	return descriptor_;
+}
+
+#ifdef SEARCH_SERVER_HAS_UNIX_SOCKETS
+
+namespace
+{
+	// a peer that went away makes send fail instead of raising SIGPIPE
+#ifdef MSG_NOSIGNAL
+	const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+	const int SEND_FLAGS = 0;
+#endif
+
+	sockaddr_un MakeAddress(const string &socket_path)
+	{
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+		if (socket_path.empty() || socket_path.size() >= sizeof(address.sun_path))
+		{
+			throw runtime_error("Invalid shard socket path "s + socket_path);
+		}
+		socket_path.copy(address.sun_path, socket_path.size());
+		return address;
+	}
+
+	ShardSocket OpenSocket()
+	{
+		ShardSocket result(socket(AF_UNIX, SOCK_STREAM, 0));
+		if (result.GetDescriptor() < 0)
+		{
+			throw runtime_error("Cannot create shard socket"s);
+		}
+#ifdef SO_NOSIGPIPE
+		const int enabled = 1;
+		setsockopt(result.GetDescriptor(), SOL_SOCKET, SO_NOSIGPIPE, &enabled, sizeof(enabled));
+#endif
+		return result;
+	}
+
+	// Returns the number of bytes read, less than size only at the end of the stream
+	size_t ReadFully(int descriptor, char *data, size_t size)
+	{
+		size_t done = 0;
+		while (done < size)
+		{
+			const ssize_t result = read(descriptor, data + done, size - done);
+			if (result == 0)
+			{
+				break;
+			}
+			if (result < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				throw runtime_error("Cannot read from shard socket"s);
+			}
+			done += static_cast<size_t>(result);
+		}
+		return done;
+	}
+
+	void WriteFully(int descriptor, const char *data, size_t size)
+	{
+		while (size > 0)
+		{
+			const ssize_t result = send(descriptor, data, size, SEND_FLAGS);
+			if (result < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				throw runtime_error("Cannot write to shard socket"s);
+			}
+			data += result;
+			size -= static_cast<size_t>(result);
+		}
+	}
+}
+
+ShardSocket ShardSocket::Connect(const string &socket_path)
+{
+	const sockaddr_un address = MakeAddress(socket_path);
+	ShardSocket result = OpenSocket();
+	if (connect(result.descriptor_, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0)
+	{
+		throw runtime_error("Cannot connect to shard "s + socket_path);
+	}
+	return result;
+}
+
+ShardSocket ShardSocket::Listen(const string &socket_path)
+{
+	const sockaddr_un address = MakeAddress(socket_path);
+	ShardSocket result = OpenSocket();
+	unlink(socket_path.c_str());
+	if (bind(result.descriptor_, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 || listen(result.descriptor_, SOMAXCONN) != 0)
+	{
+		throw runtime_error("Cannot listen on shard socket "s + socket_path);
+	}
+	return result;
+}
+
+void ShardSocket::RemoveSocketFile(const string &socket_path)
+{
+	unlink(socket_path.c_str());
+}
+
+pair<ShardSocket, ShardSocket> ShardSocket::CreatePair()
+{
+	int descriptors[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, descriptors) != 0)
+	{
+		throw runtime_error("Cannot create shard socket"s);
+	}
+	return {ShardSocket(descriptors[0]), ShardSocket(descriptors[1])};
+}
+
+ShardSocket ShardSocket::Accept() const
+{
+	for (;;)
+	{
+		const int descriptor = accept(descriptor_, nullptr, nullptr);
+		if (descriptor >= 0)
+		{
+			return ShardSocket(descriptor);
+		}
+		if (errno != EINTR)
+		{
+			throw runtime_error("Cannot accept shard connection"s);
+		}
+	}
+}
+
+bool ShardSocket::WaitForInput(const ShardSocket &interrupt) const
+{
+	pollfd descriptors[2] = {{descriptor_, POLLIN, 0}, {interrupt.descriptor_, POLLIN, 0}};
+	for (;;)
+	{
+		if (poll(descriptors, 2, -1) >= 0)
+		{
+			return descriptors[1].revents == 0;
+		}
+		if (errno != EINTR)
+		{
+			throw runtime_error("Cannot wait for shard socket"s);
+		}
+	}
+}
+
+void ShardSocket::Send(const string &message) const
+{
+	if (message.size() > MAX_SHARD_MESSAGE_SIZE)
+	{
+		throw runtime_error("Shard message is too large"s);
+	}
+	// one write for the whole message, so small requests go out in a single packet
+	string frame(sizeof(uint32_t), '\0');
+	const auto size = static_cast<uint32_t>(message.size());
+	memcpy(frame.data(), &size, sizeof(size));
+	frame += message;
+	WriteFully(descriptor_, frame.data(), frame.size());
+}
+
+bool ShardSocket::Receive(string &message) const
+{
+	uint32_t size = 0;
+	const size_t header_size = ReadFully(descriptor_, reinterpret_cast<char *>(&size), sizeof(size));
+	if (header_size == 0)
+	{
+		return false;
+	}
+	if (header_size < sizeof(size) || size > MAX_SHARD_MESSAGE_SIZE)
+	{
+		throw runtime_error("Shard message is corrupted"s);
+	}
+	message.resize(size);
+	if (ReadFully(descriptor_, message.data(), size) < size)
+	{
+		throw runtime_error("Shard connection closed in the middle of a message"s);
+	}
+	return true;
+}
+
+void ShardSocket::Close()
+{
+	if (descriptor_ >= 0)
+	{
+		close(descriptor_);
+		descriptor_ = -1;
+	}
+}
+
+#else
+
+ShardSocket ShardSocket::Connect(const string &socket_path)
+{
+	throw runtime_error("Shard sockets are not supported on this platform"s);
+}
+
+ShardSocket ShardSocket::Listen(const string &socket_path)
+{
+	throw runtime_error("Shard sockets are not supported on this platform"s);
+}
+
+void ShardSocket::RemoveSocketFile(const string &socket_path)
+{
+}
+
+pair<ShardSocket, ShardSocket> ShardSocket::CreatePair()
+{
+	throw runtime_error("Shard sockets are not supported on this platform"s);
+}
+
+ShardSocket ShardSocket::Accept() const
+{
+	throw runtime_error("Shard sockets are not supported on this platform"s);
+}
+
+bool ShardSocket::WaitForInput(const ShardSocket &interrupt) const
+{
+	throw runtime_error("Shard sockets are not supported on this platform"s);
+}
+
+void ShardSocket::Send(const string &message) const
+{
+	throw runtime_error("Shard sockets are not supported on this platform"s);
+}
+
+bool ShardSocket::Receive(string &message) const
+{
+	throw runtime_error("Shard sockets are not supported on this platform"s);
+}
+
+void ShardSocket::Close()
+{
+}
+
+#endif
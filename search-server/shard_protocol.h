@@ -0,0 +1,132 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include "document.h"
+#include "search_server.h"
+
+// Messages between RemoteSearchShard and ShardServer over a Unix domain socket.
+//
+// Every message is a uint32_t byte length followed by its fields. Both ends run on one
+// host, so numbers use the byte order of the machine; a string is a uint32_t length and
+// its characters. A request starts with its ShardRequest, a reply with its ShardReply:
+//
+//   ADD_DOCUMENT          int32_t id, uint32_t status, string text,
+//                         uint32_t rating count, int32_t ratings   -> OK
+//   REMOVE_DOCUMENT       int32_t id                               -> OK
+//   GET_DOCUMENT_COUNT                                             -> OK, int32_t count
+//   GET_QUERY_STATISTICS  string query                             -> OK, statistics
+//   FIND_TOP_DOCUMENTS    string query, statistics, uint32_t status,
+//                         uint64_t top_count                       -> OK, uint32_t count,
+//                                                                     documents
+//
+// statistics are int32_t document_count, uint32_t word count and a string and an int32_t
+// document frequency per word; a document is int32_t id, double relevance, int32_t rating.
+// A request that fails is answered with INVALID_ARGUMENT or FAILURE and a string message.
+enum class ShardRequest : uint32_t
+{
+	ADD_DOCUMENT,
+	REMOVE_DOCUMENT,
+	GET_DOCUMENT_COUNT,
+	GET_QUERY_STATISTICS,
+	FIND_TOP_DOCUMENTS,
+};
+
+enum class ShardReply : uint32_t
+{
+	OK,
+	// the shard threw std::invalid_argument
+	INVALID_ARGUMENT,
+	FAILURE,
+};
+
+// Messages above this size are treated as corrupted rather than allocated
+const size_t MAX_SHARD_MESSAGE_SIZE = size_t{1} << 30;
+// Largest top_count of FIND_TOP_DOCUMENTS, whose reply then stays far below the message
+// size; a shard answers a larger one with FAILURE
+const size_t MAX_SHARD_TOP_COUNT = size_t{1} << 20;
+
+// Builds the fields of a message
+class ShardMessageWriter
+{
+public:
+	template <typename T>
+	void Write(T value)
+	{
+		static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "Only numbers are written as they are");
+		message_.append(reinterpret_cast<const char *>(&value), sizeof(value));
+	}
+	void Write(std::string_view text);
+	void Write(const CollectionStatistics &statistics);
+	void Write(const Document &document);
+
+	[[nodiscard]] const std::string &GetBytes() const;
+
+private:
+	std::string message_;
+};
+
+// Reads the fields of a received message in order, throws std::runtime_error past its end
+class ShardMessageReader
+{
+public:
+	explicit ShardMessageReader(std::string_view message);
+
+	template <typename T>
+	T Read()
+	{
+		static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "Only numbers are read as they are");
+		T value;
+		std::memcpy(&value, Take(sizeof(value)), sizeof(value));
+		return value;
+	}
+	[[nodiscard]] std::string_view ReadString();
+	[[nodiscard]] CollectionStatistics ReadStatistics();
+	[[nodiscard]] Document ReadDocument();
+	[[nodiscard]] DocumentStatus ReadStatus();
+
+private:
+	std::string_view message_;
+
+	const char *Take(size_t size);
+};
+
+// Owned socket descriptor that sends and receives whole messages.
+// All operations throw std::runtime_error when the socket fails.
+class ShardSocket
+{
+public:
+	ShardSocket() = default;
+	explicit ShardSocket(int descriptor);
+	ShardSocket(ShardSocket &&other) noexcept;
+	ShardSocket &operator=(ShardSocket &&other) noexcept;
+	ShardSocket(const ShardSocket &) = delete;
+	ShardSocket &operator=(const ShardSocket &) = delete;
+	~ShardSocket();
+
+	// Socket connected to the ShardServer listening at socket_path
+	[[nodiscard]] static ShardSocket Connect(const std::string &socket_path);
+	// Listening socket at socket_path; a file left there by a previous server is replaced
+	[[nodiscard]] static ShardSocket Listen(const std::string &socket_path);
+	static void RemoveSocketFile(const std::string &socket_path);
+	// Two sockets connected to each other
+	[[nodiscard]] static std::pair<ShardSocket, ShardSocket> CreatePair();
+
+	[[nodiscard]] int GetDescriptor() const;
+	[[nodiscard]] ShardSocket Accept() const;
+	// Blocks until this socket or interrupt has input, returns false if interrupt has
+	[[nodiscard]] bool WaitForInput(const ShardSocket &interrupt) const;
+
+	void Send(const std::string &message) const;
+	// Returns false if the peer closed the connection before another message
+	bool Receive(std::string &message) const;
+
+private:
+	int descriptor_ = -1;
+
+	void Close();
+};
@@ -0,0 +1,116 @@
+#include "shard_server.h"
+
+#include <exception>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+ShardServer::ShardServer(SearchShard &shard, string socket_path)
+	: shard_(shard), socket_path_(move(socket_path)), listener_(ShardSocket::Listen(socket_path_)), stop_signal_(ShardSocket::CreatePair())
+{
+}
+
+ShardServer::~ShardServer()
+{
+	ShardSocket::RemoveSocketFile(socket_path_);
+}
+
+void ShardServer::Run()
+{
+	while (listener_.WaitForInput(stop_signal_.second))
+	{
+		Serve(listener_.Accept());
+	}
+}
+
+void ShardServer::Stop()
+{
+	// never read, so every later wait is interrupted as well
+	stop_signal_.first.Send(string());
+}
+
+void ShardServer::Serve(const ShardSocket &connection)
+{
+	try
+	{
+		string request;
+		while (connection.WaitForInput(stop_signal_.second) && connection.Receive(request))
+		{
+			connection.Send(HandleRequest(request));
+		}
+	}
+	catch (const runtime_error &)
+	{
+		// the client went away or is not speaking the protocol, the next one is served
+	}
+}
+
+string ShardServer::HandleRequest(string_view request)
+{
+	ShardMessageWriter error_reply;
+	try
+	{
+		ShardMessageReader reader(request);
+		ShardMessageWriter reply;
+		reply.Write(ShardReply::OK);
+		switch (reader.Read<ShardRequest>())
+		{
+		case ShardRequest::ADD_DOCUMENT:
+		{
+			const auto document_id = reader.Read<int32_t>();
+			const DocumentStatus status = reader.ReadStatus();
+			const string_view document = reader.ReadString();
+			// a corrupted count runs out of message before it runs out of memory
+			vector<int> ratings;
+			for (uint32_t rating_count = reader.Read<uint32_t>(); rating_count > 0; --rating_count)
+			{
+				ratings.push_back(reader.Read<int32_t>());
+			}
+			shard_.AddDocument(document_id, document, status, ratings);
+			break;
+		}
+		case ShardRequest::REMOVE_DOCUMENT:
+			shard_.RemoveDocument(reader.Read<int32_t>());
+			break;
+		case ShardRequest::GET_DOCUMENT_COUNT:
+			reply.Write(static_cast<int32_t>(shard_.GetDocumentCount()));
+			break;
+		case ShardRequest::GET_QUERY_STATISTICS:
+			reply.Write(shard_.GetQueryStatistics(reader.ReadString()));
+			break;
+		case ShardRequest::FIND_TOP_DOCUMENTS:
+		{
+			const string_view raw_query = reader.ReadString();
+			const CollectionStatistics statistics = reader.ReadStatistics();
+			const DocumentStatus status = reader.ReadStatus();
+			const auto top_count = reader.Read<uint64_t>();
+			if (top_count > MAX_SHARD_TOP_COUNT)
+			{
+				throw runtime_error("Too many documents requested"s);
+			}
+			const vector<Document> documents = shard_.FindTopDocuments(raw_query, statistics, status, top_count);
+			reply.Write(static_cast<uint32_t>(documents.size()));
+			for (const Document &document : documents)
+			{
+				reply.Write(document);
+			}
+			break;
+		}
+		default:
+			throw runtime_error("Unknown shard request"s);
+		}
+		return reply.GetBytes();
+	}
+	catch (const invalid_argument &error)
+	{
+		error_reply.Write(ShardReply::INVALID_ARGUMENT);
+		error_reply.Write(string_view(error.what()));
+	}
+	catch (const exception &error)
+	{
+		error_reply.Write(ShardReply::FAILURE);
+		error_reply.Write(string_view(error.what()));
+	}
+	return error_reply.GetBytes();
+}
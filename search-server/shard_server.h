@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <utility>
+#include "search_shard.h"
+#include "shard_protocol.h"
+
+// Serves a SearchShard, usually a LocalSearchShard, to RemoteSearchShard clients over a
+// Unix domain socket. Connections are served one at a time in the order they arrive, so
+// the shard is never changed while it is read; a coordinator keeps its connection open.
+// A connection that breaks or sends a corrupted message is dropped.
+class ShardServer
+{
+public:
+	// Listens at socket_path, replacing a socket file left there
+	ShardServer(SearchShard &shard, std::string socket_path);
+	ShardServer(const ShardServer &) = delete;
+	ShardServer &operator=(const ShardServer &) = delete;
+	// Removes the socket file
+	~ShardServer();
+
+	// Serves connections until Stop is called
+	void Run();
+	// Safe to call from any thread. Run returns once the request it is serving is answered.
+	void Stop();
+
+private:
+	SearchShard &shard_;
+	std::string socket_path_;
+	ShardSocket listener_;
+	// Stop writes to the first socket, which interrupts the waits of Run on the second
+	std::pair<ShardSocket, ShardSocket> stop_signal_;
+
+	void Serve(const ShardSocket &connection);
+	[[nodiscard]] std::string HandleRequest(std::string_view request);
+};
@@ -0,0 +1,112 @@
+#include "sharded_search_server.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include "shard_protocol.h"
+#include "top_documents.h"
+
+using namespace std;
+
+ShardedSearchServer::ShardedSearchServer(vector<unique_ptr<SearchShard>> shards)
+	: shards_(move(shards))
+{
+	if (shards_.empty())
+	{
+		throw invalid_argument("A sharded index needs at least one shard"s);
+	}
+	for (const auto &shard : shards_)
+	{
+		if (!shard)
+		{
+			throw invalid_argument("Shards must not be null"s);
+		}
+	}
+}
+
+void ShardedSearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int> &ratings)
+{
+	// a negative id has no shard, the shards check everything else
+	if (document_id < 0)
+	{
+		throw invalid_argument("Invalid document_id"s);
+	}
+	GetShard(document_id).AddDocument(document_id, document, status, ratings);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id)
+{
+	if (document_id >= 0)
+	{
+		GetShard(document_id).RemoveDocument(document_id);
+	}
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(string_view raw_query, DocumentStatus status, size_t top_count) const
+{
+	top_count = min(top_count, MAX_SHARD_TOP_COUNT);
+	ThreadPool &thread_pool = GetThreadPool();
+
+	vector<CollectionStatistics> shard_statistics(shards_.size());
+	thread_pool.ParallelFor(shards_.size(),
+							[&](size_t shard)
+							{
+								shard_statistics[shard] = shards_[shard]->GetQueryStatistics(raw_query);
+							});
+	CollectionStatistics statistics;
+	for (const CollectionStatistics &part : shard_statistics)
+	{
+		statistics.Add(part);
+	}
+
+	vector<vector<Document>> shard_documents(shards_.size());
+	thread_pool.ParallelFor(shards_.size(),
+							[&](size_t shard)
+							{
+								shard_documents[shard] = shards_[shard]->FindTopDocuments(raw_query, statistics, status, top_count);
+							});
+	TopDocuments top_documents(top_count);
+	for (const vector<Document> &documents : shard_documents)
+	{
+		for (const Document &document : documents)
+		{
+			top_documents.Add(document);
+		}
+	}
+	return move(top_documents).Extract();
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(string_view raw_query) const
+{
+	return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+int ShardedSearchServer::GetDocumentCount() const
+{
+	int document_count = 0;
+	for (const auto &shard : shards_)
+	{
+		document_count += shard->GetDocumentCount();
+	}
+	return document_count;
+}
+
+size_t ShardedSearchServer::GetShardCount() const
+{
+	return shards_.size();
+}
+
+void ShardedSearchServer::SetThreadPool(shared_ptr<ThreadPool> thread_pool)
+{
+	thread_pool_ = move(thread_pool);
+}
+
+SearchShard &ShardedSearchServer::GetShard(int document_id) const
+{
+	return *shards_[static_cast<size_t>(document_id) % shards_.size()];
+}
+
+ThreadPool &ShardedSearchServer::GetThreadPool() const
+{
+	return thread_pool_ ? *thread_pool_ : ThreadPool::GetDefault();
+}
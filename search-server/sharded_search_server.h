@@ -0,0 +1,41 @@
+#pragma once
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "search_shard.h"
+#include "thread_pool.h"
+
+// Coordinator of a collection partitioned by document id over shards, the shard of a
+// document being document_id % GetShardCount(). A query is answered in two scatter-gather
+// rounds: the first gathers the document counts of its plus words from every shard, the
+// second sends their sums to every shard, which scores its documents with the inverse
+// document frequencies of the whole collection, and merges the best documents of the
+// shards. Results therefore match those of a single SearchServer holding all documents.
+// Like SearchServer, queries must not run concurrently with AddDocument or RemoveDocument.
+class ShardedSearchServer
+{
+public:
+	explicit ShardedSearchServer(std::vector<std::unique_ptr<SearchShard>> shards);
+
+	void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int> &ratings);
+	void RemoveDocument(int document_id);
+
+	// Predicates cannot be sent to remote shards, so results are selected by status only.
+	// top_count is capped at MAX_SHARD_TOP_COUNT, the most documents a shard returns.
+	[[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+	[[nodiscard]] std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+	[[nodiscard]] int GetDocumentCount() const;
+	[[nodiscard]] size_t GetShardCount() const;
+
+	// Threads that send the requests of a round to the shards, nullptr (the default)
+	// selects ThreadPool::GetDefault()
+	void SetThreadPool(std::shared_ptr<ThreadPool> thread_pool);
+
+private:
+	std::vector<std::unique_ptr<SearchShard>> shards_;
+	std::shared_ptr<ThreadPool> thread_pool_;
+
+	[[nodiscard]] SearchShard &GetShard(int document_id) const;
+	[[nodiscard]] ThreadPool &GetThreadPool() const;
+};
@@ -0,0 +1,100 @@
+#include "snapshot_search_server.h"
+
+using namespace std;
+
+SnapshotSearchServer::SnapshotSearchServer(const SearchServer &search_server)
+	: servers_{make_unique<SearchServer>(search_server), make_unique<SearchServer>(search_server)}
+{
+	writer_index_ = 1;
+	PublishWriterServer();
+}
+
+SnapshotSearchServer::~SnapshotSearchServer()
+{
+	atomic_store(&published_, shared_ptr<const SearchServer>());
+	published_released_.wait();
+	if (writer_released_.valid())
+	{
+		writer_released_.wait();
+	}
+}
+
+shared_ptr<const SearchServer> SnapshotSearchServer::GetSnapshot() const
+{
+	return atomic_load(&published_);
+}
+
+void SnapshotSearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int> &ratings)
+{
+	GetWriterServer().AddDocument(document_id, document, status, ratings);
+	changes_.push_back({Change::Type::ADD, document_id, string(document), status, ratings});
+}
+
+void SnapshotSearchServer::RemoveDocument(int document_id)
+{
+	GetWriterServer().RemoveDocument(document_id);
+	changes_.push_back({Change::Type::REMOVE, document_id, {}, DocumentStatus::ACTUAL, {}});
+}
+
+void SnapshotSearchServer::Compact()
+{
+	GetWriterServer().Compact();
+	changes_.push_back({Change::Type::COMPACT, 0, {}, DocumentStatus::ACTUAL, {}});
+}
+
+void SnapshotSearchServer::Publish()
+{
+	if (changes_.empty())
+	{
+		return;
+	}
+	PublishWriterServer();
+	changes_to_replay_ = move(changes_);
+	changes_.clear();
+}
+
+SearchServer &SnapshotSearchServer::GetWriterServer()
+{
+	SearchServer &search_server = *servers_[writer_index_];
+	if (writer_released_.valid())
+	{
+		writer_released_.get();
+		for (const Change &change : changes_to_replay_)
+		{
+			ApplyChange(search_server, change);
+		}
+		changes_to_replay_.clear();
+	}
+	return search_server;
+}
+
+void SnapshotSearchServer::ApplyChange(SearchServer &search_server, const Change &change)
+{
+	switch (change.type)
+	{
+	case Change::Type::ADD:
+		search_server.AddDocument(change.document_id, change.document, change.status, change.ratings);
+		break;
+	case Change::Type::REMOVE:
+		search_server.RemoveDocument(change.document_id);
+		break;
+	case Change::Type::COMPACT:
+		search_server.Compact();
+		break;
+	}
+}
+
+void SnapshotSearchServer::PublishWriterServer()
+{
+	// the last snapshot dropped, whichever thread holds it, signals the writer instead
+	// of deleting the copy; the reference count orders its reads before the signal
+	auto released = make_shared<promise<void>>();
+	future<void> released_future = released->get_future();
+	shared_ptr<const SearchServer> snapshot(servers_[writer_index_].get(), [released](const SearchServer *)
+											{ released->set_value(); });
+
+	atomic_store(&published_, move(snapshot));
+	writer_released_ = move(published_released_);
+	published_released_ = move(released_future);
+	writer_index_ ^= 1;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <array>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "search_server.h"
+
+// SearchServer that can be read while it is being written. Readers pin the published
+// version with GetSnapshot and query it without any lock; a version never changes while
+// it is published. A single writer thread changes an unpublished copy through AddDocument,
+// RemoveDocument and Compact and makes all of its changes visible at once with Publish.
+// Two copies are kept (left-right): once the last snapshot of the previously published
+// copy is released, the writer replays the published changes on it, so the index is never
+// copied as a whole. The writer waits for such snapshots on its first change after a
+// Publish, snapshots should therefore be released promptly.
+class SnapshotSearchServer
+{
+public:
+	explicit SnapshotSearchServer(const SearchServer &search_server);
+	SnapshotSearchServer(const SnapshotSearchServer &) = delete;
+	SnapshotSearchServer &operator=(const SnapshotSearchServer &) = delete;
+	// waits until every snapshot is released
+	~SnapshotSearchServer();
+
+	// Safe to call from any thread
+	[[nodiscard]] std::shared_ptr<const SearchServer> GetSnapshot() const;
+
+	// Writer methods, to be called from one thread at a time. Invalid changes throw
+	// as in SearchServer and are not published.
+	void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int> &ratings);
+	void RemoveDocument(int document_id);
+	void Compact();
+	void Publish();
+
+private:
+	struct Change
+	{
+		enum class Type
+		{
+			ADD,
+			REMOVE,
+			COMPACT
+		};
+		Type type;
+		int document_id = 0;
+		std::string document;
+		DocumentStatus status = DocumentStatus::ACTUAL;
+		std::vector<int> ratings;
+	};
+
+	std::array<std::unique_ptr<SearchServer>, 2> servers_;
+	// the copy the writer changes, the other one is published or about to be replayed
+	size_t writer_index_ = 0;
+	// read and replaced with std::atomic_load and std::atomic_store only
+	std::shared_ptr<const SearchServer> published_;
+	// ready when the last reference to the published copy is dropped
+	std::future<void> published_released_;
+	// ready when the writer copy has no snapshots left, invalid once it was waited for
+	std::future<void> writer_released_;
+	// changes of the writer copy since the last Publish
+	std::vector<Change> changes_;
+	// changes published from the other copy that the writer copy still lacks
+	std::vector<Change> changes_to_replay_;
+
+	// Waits for the snapshots of the writer copy and brings it up to date
+	SearchServer &GetWriterServer();
+	static void ApplyChange(SearchServer &search_server, const Change &change);
+	void PublishWriterServer();
+};
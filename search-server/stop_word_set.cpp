@@ -0,0 +1,84 @@
+#include "stop_word_set.h"
+
+#include <functional>
+
+using namespace std;
+
+namespace
+{
+	const size_t INITIAL_TABLE_SIZE = 16;
+
+	uint32_t HighHash(size_t hash)
+	{
+		return static_cast<uint32_t>(static_cast<uint64_t>(hash) >> 32);
+	}
+}
+
+bool StopWordSet::Contains(string_view word) const
+{
+	if (table_.empty())
+	{
+		return false;
+	}
+	const size_t hash = std::hash<string_view>{}(word);
+	const size_t mask = table_.size() - 1;
+	for (size_t pos = hash & mask; table_[pos].word != 0; pos = (pos + 1) & mask)
+	{
+		if (table_[pos].hash == HighHash(hash) && GetWord(table_[pos].word - 1) == word)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+size_t StopWordSet::size() const
+{
+	return offsets_.size() - 1;
+}
+
+string_view StopWordSet::GetWord(size_t index) const
+{
+	return string_view(chars_).substr(offsets_[index], offsets_[index + 1] - offsets_[index]);
+}
+
+void StopWordSet::Insert(string_view word)
+{
+	if (word.empty() || Contains(word))
+	{
+		return;
+	}
+	// keep the load factor at most 1/2, so misses end after a probe or two
+	if ((size() + 1) * 2 > table_.size())
+	{
+		Grow();
+	}
+
+	chars_ += word;
+	offsets_.push_back(static_cast<uint32_t>(chars_.size()));
+
+	const size_t hash = std::hash<string_view>{}(word);
+	const size_t mask = table_.size() - 1;
+	size_t pos = hash & mask;
+	while (table_[pos].word != 0)
+	{
+		pos = (pos + 1) & mask;
+	}
+	table_[pos] = {HighHash(hash), static_cast<uint32_t>(size())};
+}
+
+void StopWordSet::Grow()
+{
+	table_.assign(table_.empty() ? INITIAL_TABLE_SIZE : table_.size() * 2, Slot{});
+	const size_t mask = table_.size() - 1;
+	for (size_t index = 0; index < size(); ++index)
+	{
+		const size_t hash = std::hash<string_view>{}(GetWord(index));
+		size_t pos = hash & mask;
+		while (table_[pos].word != 0)
+		{
+			pos = (pos + 1) & mask;
+		}
+		table_[pos] = {HighHash(hash), static_cast<uint32_t>(index + 1)};
+	}
+}
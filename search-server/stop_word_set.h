@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Immutable set of stop words, built once by the SearchServer constructors.
+// The words are packed into a single buffer and found through an open-addressing
+// table of word indexes, so a lookup hashes the word once, does not allocate and
+// usually compares a single candidate.
+class StopWordSet
+{
+public:
+	StopWordSet() = default;
+
+	// Empty strings and duplicates are skipped
+	template <typename StringContainer>
+	explicit StopWordSet(const StringContainer &words)
+	{
+		for (const auto &word : words)
+		{
+			Insert(word);
+		}
+	}
+
+	[[nodiscard]] bool Contains(std::string_view word) const;
+
+	[[nodiscard]] size_t size() const;
+	[[nodiscard]] std::string_view GetWord(size_t index) const;
+
+private:
+	struct Slot
+	{
+		// high half of the hash, compared before the text
+		uint32_t hash = 0;
+		// index + 1 of the word, 0 marks an empty slot
+		uint32_t word = 0;
+	};
+
+	void Insert(std::string_view word);
+	void Grow();
+
+	std::string chars_;
+	// word i is chars_[offsets_[i], offsets_[i + 1])
+	std::vector<uint32_t> offsets_{0};
+	std::vector<Slot> table_;
+};
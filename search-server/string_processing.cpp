@@ -3,47 +3,82 @@
 using namespace std;
 using namespace std::literals;
 
-vector<string> SplitIntoWords(const string &text)
+WordRange::Iterator::Iterator(string_view text)
+	: text_(text)
 {
-	vector<string> words;
-	string word;
-	for (const char c : text)
+	if (!text_.empty())
+	{
+		LoadBlock(0);
+	}
+	Advance();
+}
+
+void WordRange::Iterator::LoadBlock(size_t block)
+{
+	block_ = block;
+	const TextBlockMasks masks = ScanTextBlock(text_.data() + block, min(TEXT_BLOCK_SIZE, text_.size() - block));
+	// a word starts after a delimiter and ends at the next delimiter
+	const uint64_t follows_delimiter = (masks.delimiters << 1) | carry_;
+	starts_ = ~masks.delimiters & follows_delimiter;
+	ends_ = masks.delimiters & ~follows_delimiter;
+	invalid_ = masks.invalid;
+	carry_ = masks.delimiters >> (TEXT_BLOCK_SIZE - 1);
+}
+
+void WordRange::Iterator::Advance()
+{
+	while (starts_ == 0)
 	{
-		if (c == ' ')
+		if (block_ + TEXT_BLOCK_SIZE >= text_.size())
 		{
-			if (!word.empty())
-			{
-				words.push_back(word);
-				word.clear();
-			}
+			word_ = {};
+			has_control_characters_ = false;
+			return;
 		}
-		else
+		LoadBlock(block_ + TEXT_BLOCK_SIZE);
+	}
+	const int first_bit = CountTrailingZeros(starts_);
+	const size_t first = block_ + first_bit;
+	starts_ &= starts_ - 1;
+
+	// words and their ends alternate, so the lowest end left belongs to this word
+	uint64_t invalid = invalid_ & (~uint64_t{0} << first_bit);
+	bool has_control_characters = false;
+	size_t last = text_.size();
+	while (true)
+	{
+		if (ends_ != 0)
 		{
-			word += c;
+			const int last_bit = CountTrailingZeros(ends_);
+			ends_ &= ends_ - 1;
+			has_control_characters |= (invalid & ((uint64_t{1} << last_bit) - 1)) != 0;
+			last = block_ + last_bit;
+			break;
 		}
+		has_control_characters |= invalid != 0;
+		if (block_ + TEXT_BLOCK_SIZE >= text_.size())
+		{
+			break;
+		}
+		LoadBlock(block_ + TEXT_BLOCK_SIZE);
+		invalid = invalid_;
 	}
-	if (!word.empty())
+	word_ = string_view(text_.data() + first, last - first);
+	has_control_characters_ = has_control_characters;
+}
+
+vector<string> SplitIntoWords(const string &text)
+{
+	vector<string> words;
+	for (const string_view word : WordRange(text))
 	{
-		words.push_back(word);
+		words.emplace_back(word);
 	}
-
 	return words;
 }
 
 vector<string_view> SplitIntoWords(const string_view text)
 {
-
-	vector<string_view> words;
-
-	string word;
-	auto pos = text.find(' ');
-	size_t first = 0;
-	while (pos != std::string_view::npos)
-	{
-		words.push_back(text.substr(first, pos - first));
-		first = pos + 1;
-		pos = text.find(' ', first);
-	}
-	words.push_back(text.substr(first, pos - first));
-	return words;
-}
\ No newline at end of file
+	const WordRange words(text);
+	return {words.begin(), words.end()};
+}
@@ -1,8 +1,11 @@
 #pragma once
+#include <cstddef>
+#include <iterator>
 #include <set>
 #include <vector>
 #include <string>
 #include <string_view>
+#include "text_scanner.h"
 
 template <typename StringContainer>
 std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer &strings)
@@ -18,5 +21,103 @@ std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContain
     return non_empty_strings;
 }
 
+// Lazy range over the words of a text. Words are separated by runs of spaces and
+// other ASCII whitespace; they are views into the text and nothing is allocated.
+// The text is classified a block at a time by ScanTextBlock, which also marks
+// control characters, so validity is known for every word without another pass.
+class WordRange
+{
+public:
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string_view *;
+        using reference = const std::string_view &;
+
+        Iterator() = default;
+
+        reference operator*() const
+        {
+            return word_;
+        }
+
+        pointer operator->() const
+        {
+            return &word_;
+        }
+
+        Iterator &operator++()
+        {
+            Advance();
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator previous = *this;
+            Advance();
+            return previous;
+        }
+
+        bool operator==(const Iterator &other) const
+        {
+            return word_.data() == other.word_.data();
+        }
+
+        bool operator!=(const Iterator &other) const
+        {
+            return !(*this == other);
+        }
+
+        // True if the current word contains control characters
+        [[nodiscard]] bool HasControlCharacters() const
+        {
+            return has_control_characters_;
+        }
+
+    private:
+        friend class WordRange;
+
+        explicit Iterator(std::string_view text);
+
+        void LoadBlock(size_t block);
+        void Advance();
+
+        // the end iterator and an exhausted iterator both hold a null word
+        std::string_view text_;
+        std::string_view word_;
+        bool has_control_characters_ = false;
+        // word boundaries of the block starting at block_ that are not consumed yet:
+        // first characters of words and the delimiters that end them
+        size_t block_ = 0;
+        uint64_t starts_ = 0;
+        uint64_t ends_ = 0;
+        uint64_t invalid_ = 0;
+        // 1 if the last character of the previous block is a delimiter
+        uint64_t carry_ = 1;
+    };
+
+    explicit WordRange(std::string_view text)
+        : text_(text)
+    {
+    }
+
+    [[nodiscard]] Iterator begin() const
+    {
+        return Iterator(text_);
+    }
+
+    [[nodiscard]] Iterator end() const
+    {
+        return Iterator();
+    }
+
+private:
+    std::string_view text_;
+};
+
 std::vector<std::string> SplitIntoWords(const std::string &text);
-std::vector<std::string_view> SplitIntoWords(const std::string_view text);
\ No newline at end of file
+std::vector<std::string_view> SplitIntoWords(const std::string_view text);
@@ -0,0 +1,98 @@
+#include "term_dictionary.h"
+
+using namespace std;
+
+TermDictionary::TermDictionary(const TermDictionary &other)
+	: mapped_(other.mapped_), terms_(other.terms_)
+{
+	ids_.reserve(terms_.size());
+	for (size_t i = 0; i < terms_.size(); ++i)
+	{
+		ids_.emplace(terms_[i], static_cast<TermId>(mapped_.count + i));
+	}
+}
+
+TermDictionary &TermDictionary::operator=(const TermDictionary &other)
+{
+	if (this != &other)
+	{
+		*this = TermDictionary(other);
+	}
+	return *this;
+}
+
+void TermDictionary::AttachMapped(const char *chars, const uint64_t *offsets, size_t count, const uint32_t *table, size_t table_size)
+{
+	mapped_ = {chars, offsets, count, table, table_size};
+	terms_.clear();
+	ids_.clear();
+}
+
+TermId TermDictionary::Intern(string_view term)
+{
+	if (const auto term_id = Find(term))
+	{
+		return *term_id;
+	}
+	const auto term_id = static_cast<TermId>(size());
+	ids_.emplace(terms_.emplace_back(term), term_id);
+	return term_id;
+}
+
+optional<TermId> TermDictionary::Find(string_view term) const
+{
+	if (mapped_.table_size > 0)
+	{
+		const size_t mask = mapped_.table_size - 1;
+		for (size_t pos = Hash(term) & mask; mapped_.table[pos] != 0; pos = (pos + 1) & mask)
+		{
+			const TermId term_id = mapped_.table[pos] - 1;
+			if (GetTerm(term_id) == term)
+			{
+				return term_id;
+			}
+		}
+	}
+	if (const auto it = ids_.find(term); it != ids_.end())
+	{
+		return it->second;
+	}
+	return nullopt;
+}
+
+string_view TermDictionary::GetTerm(TermId term_id) const
+{
+	if (term_id < mapped_.count)
+	{
+		return {mapped_.chars + mapped_.offsets[term_id], mapped_.offsets[term_id + 1] - mapped_.offsets[term_id]};
+	}
+	return terms_.at(term_id - mapped_.count);
+}
+
+size_t TermDictionary::size() const
+{
+	return mapped_.count + terms_.size();
+}
+
+size_t TermDictionary::GetMemoryUsage() const
+{
+	size_t bytes = terms_.size() * sizeof(string) + ids_.bucket_count() * sizeof(void *);
+	for (const string &term : terms_)
+	{
+		bytes += term.capacity() + 1;
+	}
+	// a hash node holds the key, the id and the next pointer
+	return bytes + ids_.size() * (sizeof(string_view) + sizeof(TermId) + sizeof(void *));
+}
+
+uint64_t TermDictionary::Hash(string_view term)
+{
+	// 64-bit FNV-1a
+	uint64_t hash = 14695981039346656037ULL;
+	for (const char c : term)
+	{
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+using TermId = uint32_t;
+
+// Interns every indexed word into a dense TermId, so the index can be keyed by integers.
+// The first terms may come from a loaded index file: their text and their hash table
+// are used in place, terms interned afterwards get the following ids.
+class TermDictionary
+{
+public:
+	TermDictionary() = default;
+	TermDictionary(const TermDictionary &other);
+	TermDictionary &operator=(const TermDictionary &other);
+	TermDictionary(TermDictionary &&) = default;
+	TermDictionary &operator=(TermDictionary &&) = default;
+
+	// chars/offsets hold the text of term i at [offsets[i], offsets[i + 1]),
+	// table is an open-addressing table of TermId + 1 (0 is empty) probed linearly from Hash(term)
+	void AttachMapped(const char *chars, const uint64_t *offsets, size_t count, const uint32_t *table, size_t table_size);
+
+	TermId Intern(std::string_view term);
+
+	[[nodiscard]] std::optional<TermId> Find(std::string_view term) const;
+	[[nodiscard]] std::string_view GetTerm(TermId term_id) const;
+	[[nodiscard]] size_t size() const;
+	// Heap memory of the interned texts and of the hash table, approximately
+	[[nodiscard]] size_t GetMemoryUsage() const;
+
+	// Hash that is stable between processes, it is stored in index files
+	[[nodiscard]] static uint64_t Hash(std::string_view term);
+
+private:
+	struct MappedTerms
+	{
+		const char *chars = nullptr;
+		const uint64_t *offsets = nullptr;
+		size_t count = 0;
+		const uint32_t *table = nullptr;
+		size_t table_size = 0;
+	};
+	MappedTerms mapped_;
+
+	// deque keeps the interned strings in place, so the string_view keys stay valid
+	std::deque<std::string> terms_;
+	std::unordered_map<std::string_view, TermId> ids_;
+};
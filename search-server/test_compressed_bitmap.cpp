@@ -0,0 +1,90 @@
+#include "compressed_bitmap.h"
+#include "test_framework.h"
+
+#include <random>
+#include <set>
+
+using namespace std;
+
+namespace
+{
+	void AssertSameSet(const CompressedBitmap &bitmap, const set<DocumentOrdinal> &expected, DocumentOrdinal end_ordinal)
+	{
+		ASSERT_EQUAL(bitmap.size(), expected.size());
+		for (DocumentOrdinal ordinal = 0; ordinal < end_ordinal; ++ordinal)
+		{
+			ASSERT_EQUAL(bitmap.Contains(ordinal), expected.count(ordinal) > 0);
+		}
+	}
+}
+
+void TestCompressedBitmapMatchesSet()
+{
+	// three chunks, filled and emptied past the array limit in both directions
+	const DocumentOrdinal end_ordinal = 3 * 65536;
+	mt19937 generator(3);
+	CompressedBitmap bitmap;
+	set<DocumentOrdinal> expected;
+	for (const double add_probability : {0.9, 0.5, 0.1, 0.7})
+	{
+		for (int i = 0; i < 40000; ++i)
+		{
+			// the first chunk gets most of the ordinals, so it becomes dense
+			const DocumentOrdinal ordinal = uniform_int_distribution<DocumentOrdinal>(0, i % 4 == 0 ? end_ordinal - 1 : 65535)(generator);
+			if (uniform_real_distribution<>(0, 1)(generator) < add_probability)
+			{
+				bitmap.Add(ordinal);
+				expected.insert(ordinal);
+			}
+			else
+			{
+				bitmap.Remove(ordinal);
+				expected.erase(ordinal);
+			}
+		}
+		AssertSameSet(bitmap, expected, end_ordinal + 100);
+	}
+	bitmap.Remove(end_ordinal * 2);
+	ASSERT(!bitmap.Contains(end_ordinal * 2));
+}
+
+void TestCompressedBitmapHysteresis()
+{
+	CompressedBitmap bitmap;
+	for (DocumentOrdinal ordinal = 0; ordinal <= 4096; ++ordinal)
+	{
+		bitmap.Add(ordinal * 2);
+	}
+	const size_t dense_bytes = bitmap.GetMemoryUsage();
+
+	// adds and removes around the limit keep the bitmap
+	for (int i = 0; i < 100; ++i)
+	{
+		bitmap.Remove(0);
+		ASSERT_EQUAL(bitmap.GetMemoryUsage(), dense_bytes);
+		bitmap.Add(0);
+		ASSERT_EQUAL(bitmap.GetMemoryUsage(), dense_bytes);
+	}
+	for (DocumentOrdinal ordinal = 0; ordinal < 2048; ++ordinal)
+	{
+		bitmap.Remove(ordinal * 2);
+	}
+	ASSERT_EQUAL(bitmap.size(), 2049u);
+	ASSERT_EQUAL(bitmap.GetMemoryUsage(), dense_bytes);
+
+	// at half the limit it is an array again, with the same ordinals
+	bitmap.Remove(4096 * 2);
+	ASSERT(bitmap.GetMemoryUsage() < dense_bytes);
+	ASSERT_EQUAL(bitmap.size(), 2048u);
+	for (DocumentOrdinal ordinal = 0; ordinal < 8192; ++ordinal)
+	{
+		ASSERT_EQUAL(bitmap.Contains(ordinal), ordinal % 2 == 0 && ordinal >= 4096);
+	}
+}
+
+int main()
+{
+	TestRunner tr;
+	RUN_TEST(tr, TestCompressedBitmapMatchesSet);
+	RUN_TEST(tr, TestCompressedBitmapHysteresis);
+}
@@ -0,0 +1,154 @@
+#include "concurrent_map.h"
+#include "test_framework.h"
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+	const int THREAD_COUNT = 4;
+	const int KEY_COUNT = 4000;
+	const int ROUND_COUNT = 50;
+}
+
+void TestConcurrentMapAccess()
+{
+	ConcurrentMap<int, double> map(2);
+	map.Add(1, 1.5);
+	map.Add(1, 1.0);
+	map[2].ref_to_value += 4.0;
+	map[2].ref_to_value -= 1.0;
+	map[3].ref_to_value = 7.0;
+	ASSERT_EQUAL(*map.Find(1), 2.5);
+	ASSERT_EQUAL(*map.Find(2), 3.0);
+	ASSERT_EQUAL(static_cast<double>(map[3].ref_to_value), 7.0);
+	ASSERT(!map.Find(4));
+	ASSERT_EQUAL(map.size(), 3u);
+
+	ASSERT(map.Erase(2));
+	ASSERT(!map.Erase(2));
+	ASSERT(!map.Find(2));
+	ASSERT_EQUAL(map.size(), 2u);
+
+	std::map<int, double> drained;
+	map.Drain([&drained](int key, double value)
+			  { drained[key] = value; });
+	ASSERT_EQUAL(drained, (std::map<int, double>{{1, 2.5}, {3, 7.0}}));
+	ASSERT_EQUAL(map.size(), 0u);
+	ASSERT(!map.Find(1));
+	map.Add(1, 1.0);
+	ASSERT_EQUAL(*map.Find(1), 1.0);
+
+	// values that are not arithmetic are accessed under the stripe lock
+	ConcurrentMap<int, string> strings(1);
+	strings[5].ref_to_value += "ab"s;
+	strings[5].ref_to_value += "c"s;
+	ASSERT_EQUAL(*strings.Find(5), "abc"s);
+}
+
+void TestConcurrentMapEraseUnderContention()
+{
+	// two stripes, so the keys of all threads share probe runs that erases shift
+	ConcurrentMap<int, int> map(2);
+	atomic<int> failure_count = 0;
+	vector<thread> threads;
+	for (int t = 0; t < THREAD_COUNT; ++t)
+	{
+		threads.emplace_back([&map, &failure_count, t]
+							 {
+								 for (int round = 0; round < ROUND_COUNT; ++round)
+								 {
+									 for (int key = t; key < KEY_COUNT; key += THREAD_COUNT)
+									 {
+										 map.Add(key, 1);
+									 }
+									 // odd keys are erased every round, even ones keep counting
+									 for (int key = t; key < KEY_COUNT; key += THREAD_COUNT)
+									 {
+										 const auto value = map.Find(key);
+										 if (!value || *value != (key % 2 == 0 ? round + 1 : 1) || (key % 2 == 1 && !map.Erase(key)))
+										 {
+											 ++failure_count;
+										 }
+									 }
+								 }
+							 });
+	}
+	for (thread &thread : threads)
+	{
+		thread.join();
+	}
+
+	ASSERT_EQUAL(failure_count.load(), 0);
+	ASSERT_EQUAL(map.size(), static_cast<size_t>(KEY_COUNT / 2));
+	map.ForEach([&failure_count](int key, int value)
+				{
+					if (key % 2 == 1 || value != ROUND_COUNT)
+					{
+						++failure_count;
+					}
+				});
+	ASSERT_EQUAL(failure_count.load(), 0);
+}
+
+void TestConcurrentMapDrainUnderContention()
+{
+	ConcurrentMap<int, long long> map(4);
+	atomic<bool> is_adding = true;
+	std::map<int, long long> drained;
+	const auto drain = [&map, &drained]
+	{
+		map.Drain([&drained](int key, long long value)
+				  { drained[key] += value; });
+	};
+	// every Add lands either before a Drain or after it, so nothing is lost or counted twice
+	thread drainer([&is_adding, &drain]
+				   {
+					   while (is_adding)
+					   {
+						   drain();
+					   }
+				   });
+	vector<thread> adders;
+	for (int t = 0; t < THREAD_COUNT; ++t)
+	{
+		adders.emplace_back([&map]
+							{
+								for (int round = 0; round < ROUND_COUNT; ++round)
+								{
+									for (int key = 0; key < KEY_COUNT / 10; ++key)
+									{
+										map.Add(key, key);
+										map[key].ref_to_value += 1;
+									}
+								}
+							});
+	}
+	for (thread &adder : adders)
+	{
+		adder.join();
+	}
+	is_adding = false;
+	drainer.join();
+	drain();
+
+	ASSERT_EQUAL(map.size(), 0u);
+	ASSERT_EQUAL(drained.size(), static_cast<size_t>(KEY_COUNT / 10));
+	for (const auto &[key, value] : drained)
+	{
+		ASSERT_EQUAL(value, static_cast<long long>(THREAD_COUNT) * ROUND_COUNT * (key + 1));
+	}
+}
+
+int main()
+{
+	TestRunner tr;
+	RUN_TEST(tr, TestConcurrentMapAccess);
+	RUN_TEST(tr, TestConcurrentMapEraseUnderContention);
+	RUN_TEST(tr, TestConcurrentMapDrainUnderContention);
+}
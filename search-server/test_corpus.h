@@ -0,0 +1,93 @@
+#pragma once
+#include <random>
+#include <string>
+#include <vector>
+#include "document.h"
+#include "test_framework.h"
+
+// Deterministic documents and queries shared by the tests that compare
+// different indexes of one collection
+
+inline std::vector<std::string> GenerateTestWords(std::mt19937 &generator, int word_count)
+{
+	std::vector<std::string> words;
+	words.reserve(word_count);
+	for (int i = 0; i < word_count; ++i)
+	{
+		std::string word;
+		const int length = std::uniform_int_distribution(2, 6)(generator);
+		for (int j = 0; j < length; ++j)
+		{
+			word.push_back(static_cast<char>(std::uniform_int_distribution<int>('a', 'h')(generator)));
+		}
+		words.push_back(word);
+	}
+	return words;
+}
+
+inline std::string GenerateTestText(std::mt19937 &generator, const std::vector<std::string> &words, int word_count, double minus_prob = 0)
+{
+	std::string text;
+	for (int i = 0; i < word_count; ++i)
+	{
+		if (!text.empty())
+		{
+			text.push_back(' ');
+		}
+		if (std::uniform_real_distribution<>(0, 1)(generator) < minus_prob)
+		{
+			text.push_back('-');
+		}
+		text += words[std::uniform_int_distribution<size_t>(0, words.size() - 1)(generator)];
+	}
+	return text;
+}
+
+// documents[i] is the text of document i
+struct TestCorpus
+{
+	std::string stop_words;
+	std::vector<std::string> documents;
+	std::vector<std::string> queries;
+};
+
+inline TestCorpus GenerateTestCorpus(int document_count, int query_count, unsigned seed = 42)
+{
+	std::mt19937 generator(seed);
+	const std::vector<std::string> words = GenerateTestWords(generator, 300);
+
+	TestCorpus corpus;
+	corpus.stop_words = words[0] + ' ' + words[1];
+	for (int i = 0; i < document_count; ++i)
+	{
+		corpus.documents.push_back(GenerateTestText(generator, words, std::uniform_int_distribution(1, 30)(generator)));
+	}
+	for (int i = 0; i < query_count; ++i)
+	{
+		corpus.queries.push_back(GenerateTestText(generator, words, std::uniform_int_distribution(1, 6)(generator), 0.2));
+	}
+	return corpus;
+}
+
+inline DocumentStatus GetTestStatus(int document_id)
+{
+	return document_id % 7 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+}
+
+inline std::vector<int> GetTestRatings(int document_id)
+{
+	return {document_id % 11 - 5, document_id % 3};
+}
+
+// Results of two indexes of the same collection are the same documents in the same
+// order with bit-identical relevances
+inline void AssertSameDocuments(const std::vector<Document> &expected, const std::vector<Document> &actual, const std::string &hint)
+{
+	AssertEqual(actual.size(), expected.size(), hint);
+	for (size_t i = 0; i < expected.size(); ++i)
+	{
+		AssertEqual(actual[i].id, expected[i].id, hint);
+		AssertEqual(actual[i].relevance, expected[i].relevance, hint);
+		AssertEqual(actual[i].rating, expected[i].rating, hint);
+	}
+}
@@ -10,13 +10,13 @@ void PrintDocument(const Document& document)
         << "rating = " << document.rating << " }" << std::endl;
 }
 
-void PrintMatchDocumentResult(int document_id, const std::vector<std::string>& words, DocumentStatus status)
+void PrintMatchDocumentResult(int document_id, const std::vector<std::string_view>& words, DocumentStatus status)
 {
     std::cout << "{ "
         << "document_id = " << document_id << ", "
         << "status = " << static_cast<int>(status) << ", "
         << "words =";
-    for (const std::string& word : words) 
+    for (const std::string_view word : words) 
     {
         std::cout << ' ' << word;
     }
@@ -0,0 +1,257 @@
+#include "index_file.h"
+#include "search_server.h"
+#include "test_corpus.h"
+#include "test_framework.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+	const string INDEX_PATH = (filesystem::temp_directory_path() / "search_server_test_index.idx").string();
+
+	SearchServer MakeServer(const TestCorpus &corpus)
+	{
+		SearchServer server(corpus.stop_words);
+		for (size_t i = 0; i < corpus.documents.size(); ++i)
+		{
+			const int document_id = static_cast<int>(i);
+			server.AddDocument(document_id, corpus.documents[i], GetTestStatus(document_id), GetTestRatings(document_id));
+		}
+		return server;
+	}
+
+	void AssertSameResults(const SearchServer &expected, const SearchServer &actual, const TestCorpus &corpus)
+	{
+		for (const string &query : corpus.queries)
+		{
+			AssertSameDocuments(expected.FindTopDocuments(query), actual.FindTopDocuments(query), query);
+			AssertSameDocuments(expected.FindTopDocuments(query, DocumentStatus::BANNED), actual.FindTopDocuments(query, DocumentStatus::BANNED), query);
+		}
+		ASSERT_EQUAL(actual.GetDocumentCount(), expected.GetDocumentCount());
+	}
+
+	string ReadFile(const string &path)
+	{
+		ifstream input(path, ios::binary);
+		return {istreambuf_iterator<char>(input), istreambuf_iterator<char>()};
+	}
+
+	void WriteFile(const string &path, const string &bytes)
+	{
+		ofstream(path, ios::binary | ios::trunc).write(bytes.data(), static_cast<streamsize>(bytes.size()));
+	}
+
+	IndexFileHeader GetHeader(const string &bytes)
+	{
+		IndexFileHeader header;
+		memcpy(&header, bytes.data(), sizeof(header));
+		return header;
+	}
+
+	template <typename T>
+	T ReadItem(const string &bytes, uint64_t section, uint64_t index)
+	{
+		T item;
+		memcpy(&item, bytes.data() + section + index * sizeof(T), sizeof(T));
+		return item;
+	}
+
+	template <typename T>
+	void WriteItem(string &bytes, uint64_t section, uint64_t index, const T &item)
+	{
+		memcpy(bytes.data() + section + index * sizeof(T), &item, sizeof(T));
+	}
+
+	// Saves a server whose first term has full posting blocks and returns the file
+	string SaveBlockIndex()
+	{
+		const TestCorpus corpus = GenerateTestCorpus(500, 0);
+		SearchServer server(corpus.stop_words);
+		for (size_t i = 0; i < corpus.documents.size(); ++i)
+		{
+			server.AddDocument(static_cast<int>(i), "common "s + corpus.documents[i], DocumentStatus::ACTUAL, {1});
+		}
+		server.SaveIndex(INDEX_PATH);
+		return ReadFile(INDEX_PATH);
+	}
+
+	void AssertRejected(const string &bytes, const string &hint)
+	{
+		WriteFile(INDEX_PATH, bytes);
+		try
+		{
+			(void)SearchServer::LoadIndex(INDEX_PATH);
+		}
+		catch (const runtime_error &)
+		{
+			return;
+		}
+		Assert(false, "Corrupted index file is loaded: "s + hint);
+	}
+}
+
+void TestSaveAndLoad()
+{
+	const TestCorpus corpus = GenerateTestCorpus(500, 100);
+	SearchServer server = MakeServer(corpus);
+	server.RemoveDocument(3);
+
+	server.SaveIndex(INDEX_PATH);
+	const SearchServer loaded = SearchServer::LoadIndex(INDEX_PATH);
+	AssertSameResults(server, loaded, corpus);
+	ASSERT(!loaded.HasDocument(3));
+}
+
+void TestSaveOverLoadedFile()
+{
+	const TestCorpus corpus = GenerateTestCorpus(500, 100);
+	SearchServer expected = MakeServer(corpus);
+	expected.SaveIndex(INDEX_PATH);
+
+	// the loaded server reads the file it is saved over
+	SearchServer loaded = SearchServer::LoadIndex(INDEX_PATH);
+	expected.AddDocument(1000, corpus.queries[0], DocumentStatus::ACTUAL, {5});
+	loaded.AddDocument(1000, corpus.queries[0], DocumentStatus::ACTUAL, {5});
+	expected.RemoveDocument(10);
+	loaded.RemoveDocument(10);
+	loaded.SaveIndex(INDEX_PATH);
+	AssertSameResults(expected, loaded, corpus);
+
+	const SearchServer reloaded = SearchServer::LoadIndex(INDEX_PATH);
+	AssertSameResults(expected, reloaded, corpus);
+	ASSERT(!filesystem::exists(INDEX_PATH + ".tmp"s));
+}
+
+void TestLoadRejectsCorruptedTermTable()
+{
+	const string bytes = SaveBlockIndex();
+	const IndexFileHeader header = GetHeader(bytes);
+	ASSERT(header.term_table_size > header.term_count);
+
+	// a table as large as the term count may be full
+	string corrupted = bytes;
+	IndexFileHeader full_header = header;
+	full_header.term_table_size = 1;
+	while (full_header.term_table_size * 2 <= header.term_count)
+	{
+		full_header.term_table_size *= 2;
+	}
+	WriteItem(corrupted, 0, 0, full_header);
+	AssertRejected(corrupted, "term table without room for an empty slot"s);
+
+	corrupted = bytes;
+	for (uint64_t i = 0; i < header.term_table_size; ++i)
+	{
+		if (ReadItem<uint32_t>(corrupted, header.term_table, i) == 0)
+		{
+			WriteItem<uint32_t>(corrupted, header.term_table, i, 1);
+		}
+	}
+	AssertRejected(corrupted, "term table without empty slots"s);
+
+	corrupted = bytes;
+	for (uint64_t i = 0; i < header.term_table_size; ++i)
+	{
+		if (ReadItem<uint32_t>(corrupted, header.term_table, i) != 0)
+		{
+			WriteItem(corrupted, header.term_table, i, static_cast<uint32_t>(header.term_count + 1));
+			break;
+		}
+	}
+	AssertRejected(corrupted, "term table entry past the terms"s);
+}
+
+void TestLoadRejectsCorruptedPostings()
+{
+	const string bytes = SaveBlockIndex();
+	const IndexFileHeader header = GetHeader(bytes);
+	ASSERT(header.posting_block_count > 0);
+	ASSERT(header.posting_tail_count > 0);
+
+	string corrupted = bytes;
+	auto block = ReadItem<PostingBlock>(corrupted, header.posting_blocks, 0);
+	block.first_ordinal = static_cast<DocumentOrdinal>(header.ordinal_count);
+	WriteItem(corrupted, header.posting_blocks, 0, block);
+	AssertRejected(corrupted, "block ordinal past the ordinals"s);
+
+	corrupted = bytes;
+	block = ReadItem<PostingBlock>(corrupted, header.posting_blocks, 0);
+	++block.last_ordinal;
+	WriteItem(corrupted, header.posting_blocks, 0, block);
+	AssertRejected(corrupted, "skip entry disagreeing with its block"s);
+
+	corrupted = bytes;
+	auto posting = ReadItem<Posting>(corrupted, header.posting_tails, 0);
+	posting.document_ordinal = static_cast<DocumentOrdinal>(header.ordinal_count + 100);
+	WriteItem(corrupted, header.posting_tails, 0, posting);
+	AssertRejected(corrupted, "tail ordinal past the ordinals"s);
+
+	corrupted = bytes;
+	IndexFileHeader short_header = header;
+	short_header.ordinal_count /= 2;
+	WriteItem(corrupted, 0, 0, short_header);
+	AssertRejected(corrupted, "postings of ordinals the file does not have"s);
+
+	WriteFile(INDEX_PATH, bytes);
+	ASSERT_DOESNT_THROW((void)SearchServer::LoadIndex(INDEX_PATH));
+}
+
+void TestLoadRejectsCorruptedDocuments()
+{
+	const string bytes = SaveBlockIndex();
+	const IndexFileHeader header = GetHeader(bytes);
+	ASSERT(header.document_count > 1);
+	const auto first = ReadItem<IndexFileDocument>(bytes, header.documents, 0);
+
+	// the ordinal of the copy names it too, only the id is stored twice
+	string corrupted = bytes;
+	auto second = ReadItem<IndexFileDocument>(corrupted, header.documents, 1);
+	second.id = first.id;
+	WriteItem(corrupted, header.documents, 1, second);
+	WriteItem<int32_t>(corrupted, header.ordinals, second.ordinal, first.id);
+	AssertRejected(corrupted, "document id stored twice"s);
+
+	corrupted = bytes;
+	WriteItem<int32_t>(corrupted, header.ordinals, first.ordinal, first.id + 100000);
+	AssertRejected(corrupted, "ordinal of another document"s);
+}
+
+void TestLoadRejectsWrappingCounts()
+{
+	const string bytes = SaveBlockIndex();
+	const IndexFileHeader header = GetHeader(bytes);
+
+	// a count of UINT64_MAX makes its offset table one entry long
+	string corrupted = bytes;
+	IndexFileHeader wrapping_header = header;
+	wrapping_header.stop_word_count = numeric_limits<uint64_t>::max();
+	WriteItem(corrupted, 0, 0, wrapping_header);
+	AssertRejected(corrupted, "stop word count wrapping"s);
+
+	corrupted = bytes;
+	wrapping_header = header;
+	wrapping_header.term_count = numeric_limits<uint64_t>::max();
+	WriteItem(corrupted, 0, 0, wrapping_header);
+	AssertRejected(corrupted, "term count wrapping"s);
+}
+
+int main()
+{
+	TestRunner tr;
+	RUN_TEST(tr, TestSaveAndLoad);
+	RUN_TEST(tr, TestSaveOverLoadedFile);
+	RUN_TEST(tr, TestLoadRejectsCorruptedTermTable);
+	RUN_TEST(tr, TestLoadRejectsCorruptedPostings);
+	RUN_TEST(tr, TestLoadRejectsCorruptedDocuments);
+	RUN_TEST(tr, TestLoadRejectsWrappingCounts);
+	filesystem::remove(INDEX_PATH);
+}
@@ -0,0 +1,210 @@
+#include "bit_packing.h"
+#include "posting_list.h"
+#include "test_framework.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+	// Random increasing postings whose gaps take up to max_gap_bits bits
+	vector<Posting> GeneratePostings(mt19937 &generator, size_t size, int max_gap_bits)
+	{
+		vector<Posting> postings;
+		DocumentOrdinal ordinal = uniform_int_distribution<DocumentOrdinal>(0, 1000)(generator);
+		for (size_t i = 0; i < size; ++i)
+		{
+			const int gap_bits = uniform_int_distribution(0, max_gap_bits)(generator);
+			const uint32_t count = uniform_int_distribution(0, 3)(generator) == 0 ? uniform_int_distribution<uint32_t>(1, 100000)(generator) : 1;
+			postings.push_back({ordinal, count});
+			ordinal += 1 + (gap_bits == 0 ? 0 : uniform_int_distribution<uint32_t>(0, (uint32_t{1} << gap_bits) - 1)(generator));
+		}
+		return postings;
+	}
+
+	PostingList MakePostingList(const vector<Posting> &postings)
+	{
+		PostingList list;
+		for (const Posting &posting : postings)
+		{
+			list.Add(posting.document_ordinal, posting.count);
+		}
+		return list;
+	}
+
+	void AssertSamePostings(const PostingList &list, const vector<Posting> &expected, const string &hint)
+	{
+		AssertEqual(list.size(), expected.size(), hint);
+		PostingList::Cursor cursor(list);
+		for (size_t i = 0; i < expected.size(); ++i, cursor.Next())
+		{
+			AssertEqual(cursor.IsAtEnd(), false, hint);
+			AssertEqual(cursor.GetPosition(), i, hint);
+			AssertEqual(cursor.GetOrdinal(), expected[i].document_ordinal, hint);
+			AssertEqual(cursor.GetCount(), expected[i].count, hint);
+		}
+		AssertEqual(cursor.IsAtEnd(), true, hint);
+		AssertEqual(cursor.GetPosition(), expected.size(), hint);
+	}
+}
+
+void TestBitPackingRoundTrip()
+{
+	mt19937 generator(5);
+	const size_t block_size = BIT_PACKING_BLOCK_SIZE;
+	for (int bit_width = 0; bit_width <= 32; ++bit_width)
+	{
+		const string hint = "bit width "s + to_string(bit_width);
+		const uint32_t max_value = bit_width == 32 ? UINT32_MAX : (uint32_t{1} << bit_width) - 1;
+		vector<uint32_t> values(block_size);
+		for (size_t i = 0; i < block_size; ++i)
+		{
+			// the extremes in every lane and at both ends
+			values[i] = i % 9 == 0 ? max_value : i % 9 == 1 ? 0 : uniform_int_distribution<uint32_t>(0, max_value)(generator);
+		}
+		AssertEqual(GetBitWidth(max_value), bit_width, hint);
+
+		// the packed block takes exactly its words, the sentinel after them stays
+		const uint32_t sentinel = 0xdeadbeef;
+		vector<uint32_t> words(GetPackedWordCount(bit_width) + 1, sentinel);
+		PackBlock(values.data(), bit_width, words.data());
+		AssertEqual(words.back(), sentinel, hint);
+
+		vector<uint32_t> unpacked(block_size, sentinel);
+		UnpackBlock(words.data(), bit_width, unpacked.data());
+		AssertEqual(unpacked, values, hint);
+
+		// the values are read as gaps less one of an increasing sequence
+		const uint32_t previous = uniform_int_distribution<uint32_t>(0, 1000)(generator);
+		vector<uint32_t> expected(block_size);
+		uint32_t last = previous;
+		for (size_t i = 0; i < block_size; ++i)
+		{
+			last += values[i] + 1;
+			expected[i] = last;
+		}
+		UnpackIncreasingBlock(words.data(), bit_width, previous, unpacked.data());
+		AssertEqual(unpacked, expected, hint);
+	}
+	ASSERT_EQUAL(GetBitWidth(0), 0);
+	ASSERT_EQUAL(GetBitWidth(1), 1);
+	ASSERT_EQUAL(GetBitWidth(128), 8);
+}
+
+void TestPostingListRoundTrip()
+{
+	mt19937 generator(6);
+	for (const size_t size : {size_t{0}, size_t{1}, size_t{127}, size_t{128}, size_t{129}, size_t{1000}})
+	{
+		for (const int max_gap_bits : {0, 3, 12, 20})
+		{
+			const string hint = "size "s + to_string(size) + ", gap bits "s + to_string(max_gap_bits);
+			const vector<Posting> postings = GeneratePostings(generator, size, max_gap_bits);
+			const PostingList list = MakePostingList(postings);
+			AssertSamePostings(list, postings, hint);
+			AssertEqual(list.GetBlockCount(), size / POSTING_BLOCK_SIZE, hint);
+
+			const DocumentOrdinal end_ordinal = postings.empty() ? 0 : postings.back().document_ordinal + 1;
+			AssertEqual(list.AreOrdinalsValid(end_ordinal), true, hint);
+			if (!postings.empty())
+			{
+				AssertEqual(list.AreOrdinalsValid(end_ordinal - 1), false, hint);
+			}
+
+			// a view of the arrays reads the same, and a copy of it is modified on its own
+			PostingList view = PostingList::View(list.GetBlocks(), list.GetBlockCount(), list.GetWords(), list.GetWordCount(), list.GetTail(), list.GetTailSize());
+			AssertSamePostings(view, postings, hint);
+			vector<Posting> extended = postings;
+			for (int i = 0; i < 200; ++i)
+			{
+				extended.push_back({(extended.empty() ? 0 : extended.back().document_ordinal) + 1 + static_cast<DocumentOrdinal>(i % 5), 1 + static_cast<uint32_t>(i % 3)});
+				view.Add(extended.back().document_ordinal, extended.back().count);
+			}
+			AssertSamePostings(view, extended, hint);
+			AssertSamePostings(list, postings, hint);
+		}
+	}
+}
+
+void TestCursorSeek()
+{
+	mt19937 generator(7);
+	const vector<Posting> postings = GeneratePostings(generator, 1000, 8);
+	const PostingList list = MakePostingList(postings);
+	const DocumentOrdinal last_ordinal = postings.back().document_ordinal;
+
+	// targets at block boundaries, between postings, on postings and past the end
+	vector<DocumentOrdinal> targets;
+	for (size_t block = 0; block * POSTING_BLOCK_SIZE < postings.size(); ++block)
+	{
+		const size_t first = block * POSTING_BLOCK_SIZE;
+		const size_t last = min(first + POSTING_BLOCK_SIZE, postings.size()) - 1;
+		targets.push_back(postings[first].document_ordinal);
+		targets.push_back(postings[last].document_ordinal);
+		targets.push_back(postings[last].document_ordinal + 1);
+	}
+	for (int i = 0; i < 300; ++i)
+	{
+		targets.push_back(uniform_int_distribution<DocumentOrdinal>(0, last_ordinal + 10)(generator));
+	}
+	const auto find_expected = [&postings](DocumentOrdinal target)
+	{
+		return static_cast<size_t>(lower_bound(postings.begin(), postings.end(), target,
+											   [](const Posting &posting, DocumentOrdinal ordinal)
+											   { return posting.document_ordinal < ordinal; }) -
+								   postings.begin());
+	};
+
+	for (int run = 0; run < 20; ++run)
+	{
+		// a cursor only moves forward, so every run seeks in increasing order from the start
+		shuffle(targets.begin(), targets.end(), generator);
+		vector<DocumentOrdinal> run_targets(targets.begin(), targets.begin() + 40);
+		sort(run_targets.begin(), run_targets.end());
+		PostingList::Cursor cursor(list);
+		for (const DocumentOrdinal target : run_targets)
+		{
+			const size_t expected = find_expected(target);
+			cursor.Seek(target);
+			ASSERT_EQUAL(cursor.GetPosition(), expected);
+			ASSERT_EQUAL(cursor.IsAtEnd(), expected == postings.size());
+			if (expected < postings.size())
+			{
+				ASSERT_EQUAL(cursor.GetOrdinal(), postings[expected].document_ordinal);
+				ASSERT_EQUAL(cursor.GetCount(), postings[expected].count);
+			}
+		}
+	}
+
+	// ForEachBefore visits windows in turn, as the scoring does
+	PostingList::Cursor cursor(list);
+	vector<Posting> visited;
+	for (DocumentOrdinal window_end = 0; window_end <= last_ordinal + 300; window_end += 300)
+	{
+		cursor.ForEachBefore(window_end, [&visited, window_end](DocumentOrdinal ordinal, uint32_t count)
+							 {
+								 ASSERT(ordinal < window_end);
+								 visited.push_back({ordinal, count});
+							 });
+		ASSERT_EQUAL(cursor.GetPosition(), find_expected(window_end));
+	}
+	ASSERT_EQUAL(visited.size(), postings.size());
+	for (size_t i = 0; i < postings.size(); ++i)
+	{
+		ASSERT_EQUAL(visited[i].document_ordinal, postings[i].document_ordinal);
+		ASSERT_EQUAL(visited[i].count, postings[i].count);
+	}
+}
+
+int main()
+{
+	TestRunner tr;
+	RUN_TEST(tr, TestBitPackingRoundTrip);
+	RUN_TEST(tr, TestPostingListRoundTrip);
+	RUN_TEST(tr, TestCursorSeek);
+}
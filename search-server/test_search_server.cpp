@@ -0,0 +1,674 @@
+#include "process_queries.h"
+#include "search_server.h"
+#include "test_corpus.h"
+#include "test_framework.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <execution>
+#include <future>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+	const int DOCUMENT_COUNT = 500;
+
+	SearchServer MakeServer(const TestCorpus &corpus)
+	{
+		SearchServer server(corpus.stop_words);
+		for (int document_id = 0; document_id < static_cast<int>(corpus.documents.size()); ++document_id)
+		{
+			server.AddDocument(document_id, corpus.documents[document_id], GetTestStatus(document_id), GetTestRatings(document_id));
+		}
+		return server;
+	}
+
+	vector<RawDocument> MakeRawDocuments(const TestCorpus &corpus, int first_id, int last_id)
+	{
+		vector<RawDocument> documents;
+		for (int document_id = first_id; document_id < last_id; ++document_id)
+		{
+			documents.push_back({document_id, corpus.documents[document_id], GetTestStatus(document_id), GetTestRatings(document_id)});
+		}
+		return documents;
+	}
+
+	set<string> SplitReferenceWords(const string &text)
+	{
+		istringstream input(text);
+		set<string> words;
+		for (string word; input >> word;)
+		{
+			words.insert(word);
+		}
+		return words;
+	}
+
+	// Term frequencies of a text computed without an index: counts of the words that are
+	// not stop words divided by how many such words the text has
+	map<string, double> ComputeReferenceFreqs(const string &text, const set<string> &stop_words)
+	{
+		map<string, int> counts;
+		int word_count = 0;
+		istringstream input(text);
+		for (string word; input >> word;)
+		{
+			if (stop_words.count(word) == 0)
+			{
+				++counts[word];
+				++word_count;
+			}
+		}
+		map<string, double> freqs;
+		for (const auto &[word, count] : counts)
+		{
+			freqs[word] = static_cast<double>(count) / word_count;
+		}
+		return freqs;
+	}
+
+	// Two servers that indexed the same documents find the same results and word frequencies
+	void AssertSameServers(const SearchServer &expected, const SearchServer &actual, const TestCorpus &corpus, const string &stage)
+	{
+		ASSERT_EQUAL(actual.GetDocumentCount(), expected.GetDocumentCount());
+		for (const string &query : corpus.queries)
+		{
+			const string hint = stage + ": "s + query;
+			AssertSameDocuments(expected.FindTopDocuments(query), actual.FindTopDocuments(query), hint);
+			AssertSameDocuments(expected.FindTopDocuments(query, DocumentStatus::BANNED, 20), actual.FindTopDocuments(query, DocumentStatus::BANNED, 20), hint);
+			const auto is_even = [](int document_id, DocumentStatus, int)
+			{
+				return document_id % 2 == 0;
+			};
+			AssertSameDocuments(expected.FindTopDocuments(query, is_even), actual.FindTopDocuments(query, is_even), hint);
+		}
+		for (const int document_id : expected)
+		{
+			ASSERT_EQUAL(actual.GetWordFrequencies(document_id), expected.GetWordFrequencies(document_id));
+		}
+	}
+}
+
+void TestUnboundedTopCount()
+{
+	const TestCorpus corpus = GenerateTestCorpus(DOCUMENT_COUNT, 50);
+	const SearchServer server = MakeServer(corpus);
+
+	// a top_count past every document asks for all of them, it must not be reserved up front
+	for (const string &query : corpus.queries)
+	{
+		const vector<Document> all = server.FindTopDocuments(query, DocumentStatus::ACTUAL, DOCUMENT_COUNT);
+		AssertSameDocuments(all, server.FindTopDocuments(query, DocumentStatus::ACTUAL, SIZE_MAX), query);
+		AssertSameDocuments(all, server.FindTopDocuments(execution::par, query, DocumentStatus::ACTUAL, SIZE_MAX), query);
+		AssertSameDocuments(all, server.FindTopDocumentsAsync(query, DocumentStatus::ACTUAL, SIZE_MAX).get(), query);
+	}
+}
+
+void TestMatchesReferenceRanking()
+{
+	const TestCorpus corpus = GenerateTestCorpus(DOCUMENT_COUNT, 50);
+	SearchServer server = MakeServer(corpus);
+	for (int document_id = 0; document_id < DOCUMENT_COUNT; document_id += 5)
+	{
+		server.RemoveDocument(document_id);
+	}
+	const set<string> stop_words = SplitReferenceWords(corpus.stop_words);
+	map<int, map<string, double>> document_freqs;
+	for (const int document_id : server)
+	{
+		document_freqs[document_id] = ComputeReferenceFreqs(corpus.documents[document_id], stop_words);
+	}
+	const auto get_document_freq = [&document_freqs](const string &word)
+	{
+		return count_if(document_freqs.begin(), document_freqs.end(), [&word](const auto &document)
+						{ return document.second.count(word) > 0; });
+	};
+
+	// relevance is the sum of tf * log(N / df) over the plus words a document has
+	for (const string &query : corpus.queries)
+	{
+		set<string> plus_words;
+		set<string> minus_words;
+		for (const string &word : SplitReferenceWords(query))
+		{
+			const bool is_minus = word[0] == '-';
+			const string text = is_minus ? word.substr(1) : word;
+			if (stop_words.count(text) == 0)
+			{
+				(is_minus ? minus_words : plus_words).insert(text);
+			}
+		}
+
+		map<int, double> expected;
+		for (const auto &[document_id, freqs] : document_freqs)
+		{
+			if (GetTestStatus(document_id) != DocumentStatus::ACTUAL ||
+				any_of(minus_words.begin(), minus_words.end(), [&freqs](const string &word)
+					   { return freqs.count(word) > 0; }))
+			{
+				continue;
+			}
+			for (const string &word : plus_words)
+			{
+				if (const auto it = freqs.find(word); it != freqs.end())
+				{
+					expected[document_id] += it->second * log(static_cast<double>(server.GetDocumentCount()) / get_document_freq(word));
+				}
+			}
+		}
+
+		const vector<Document> found = server.FindTopDocuments(query, DocumentStatus::ACTUAL, DOCUMENT_COUNT);
+		AssertEqual(found.size(), expected.size(), query);
+		for (size_t i = 0; i < found.size(); ++i)
+		{
+			const Document &document = found[i];
+			Assert(expected.count(document.id) > 0, query);
+			Assert(abs(document.relevance - expected.at(document.id)) < 1e-9, query);
+			const vector<int> ratings = GetTestRatings(document.id);
+			AssertEqual(document.rating, (ratings[0] + ratings[1]) / 2, query);
+			Assert(i == 0 || found[i - 1].relevance > document.relevance - 1e-6, query);
+		}
+	}
+}
+
+void TestScoresDoNotLeakBetweenQueries()
+{
+	const TestCorpus corpus = GenerateTestCorpus(DOCUMENT_COUNT, 50);
+	const SearchServer large = MakeServer(corpus);
+	SearchServer small(corpus.stop_words);
+	for (int document_id = 0; document_id < 40; ++document_id)
+	{
+		small.AddDocument(document_id, corpus.documents[document_id], GetTestStatus(document_id), GetTestRatings(document_id));
+	}
+
+	// results of a thread whose accumulator has scored nothing yet
+	const auto find_on_new_thread = [](const SearchServer &server, const string &query)
+	{
+		return async(launch::async, [&server, &query]
+					 { return server.FindTopDocuments(query, DocumentStatus::ACTUAL, DOCUMENT_COUNT); })
+			.get();
+	};
+	vector<vector<Document>> expected_large;
+	vector<vector<Document>> expected_small;
+	for (const string &query : corpus.queries)
+	{
+		expected_large.push_back(find_on_new_thread(large, query));
+		expected_small.push_back(find_on_new_thread(small, query));
+	}
+
+	// this thread's accumulator goes back and forth between the sizes of both servers
+	for (int round = 0; round < 2; ++round)
+	{
+		for (size_t i = 0; i < corpus.queries.size(); ++i)
+		{
+			const string &query = corpus.queries[i];
+			AssertSameDocuments(expected_large[i], large.FindTopDocuments(query, DocumentStatus::ACTUAL, DOCUMENT_COUNT), query);
+			AssertSameDocuments(expected_small[i], small.FindTopDocuments(query, DocumentStatus::ACTUAL, DOCUMENT_COUNT), query);
+			AssertSameDocuments(expected_large[i], large.FindTopDocuments(execution::par, query, DocumentStatus::ACTUAL, DOCUMENT_COUNT), query);
+			AssertSameDocuments(expected_small[i], small.FindTopDocuments(execution::par, query, DocumentStatus::ACTUAL, DOCUMENT_COUNT), query);
+		}
+	}
+}
+
+void TestIdfFollowsChanges()
+{
+	const TestCorpus corpus = GenerateTestCorpus(DOCUMENT_COUNT, 50);
+	SearchServer changed(corpus.stop_words);
+	set<int> document_ids;
+	const auto add = [&](int document_id, const string &text)
+	{
+		changed.AddDocument(document_id, text, GetTestStatus(document_id), GetTestRatings(document_id));
+		document_ids.insert(document_id);
+	};
+	const auto remove = [&](int document_id)
+	{
+		changed.RemoveDocument(document_id);
+		document_ids.erase(document_id);
+	};
+	// queries fill the cached logarithms before every change
+	const auto assert_same = [&](const string &stage)
+	{
+		SearchServer rebuilt(corpus.stop_words);
+		for (const int document_id : document_ids)
+		{
+			const string &text = document_id < DOCUMENT_COUNT ? corpus.documents[document_id] : corpus.queries[0];
+			rebuilt.AddDocument(document_id, text, GetTestStatus(document_id), GetTestRatings(document_id));
+		}
+		AssertSameServers(rebuilt, changed, corpus, stage);
+	};
+
+	for (int document_id = 0; document_id < DOCUMENT_COUNT / 2; ++document_id)
+	{
+		add(document_id, corpus.documents[document_id]);
+	}
+	assert_same("added"s);
+
+	// a document of a few query words changes their document counts and the total only
+	add(DOCUMENT_COUNT, corpus.queries[0]);
+	assert_same("added a query"s);
+	remove(DOCUMENT_COUNT);
+	assert_same("removed the query"s);
+
+	for (int document_id = 0; document_id < DOCUMENT_COUNT / 2; document_id += 3)
+	{
+		remove(document_id);
+	}
+	assert_same("removed"s);
+
+	// a copy starts with a cold cache, the original keeps its own
+	SearchServer copy = changed;
+	AssertSameServers(changed, copy, corpus, "copied"s);
+	copy.AddDocument(DOCUMENT_COUNT, corpus.queries[0], DocumentStatus::ACTUAL, {1});
+	assert_same("original of a changed copy"s);
+	for (int document_id = DOCUMENT_COUNT / 2; document_id < DOCUMENT_COUNT; ++document_id)
+	{
+		add(document_id, corpus.documents[document_id]);
+	}
+	assert_same("added again"s);
+}
+
+void TestWordFrequenciesSkipStopWords()
+{
+	const TestCorpus corpus = GenerateTestCorpus(DOCUMENT_COUNT, 0);
+	SearchServer server = MakeServer(corpus);
+	const set<string> stop_words = SplitReferenceWords(corpus.stop_words);
+	for (const int document_id : server)
+	{
+		const map<string, double> expected = ComputeReferenceFreqs(corpus.documents[document_id], stop_words);
+		const map<string_view, double> actual = server.GetWordFrequencies(document_id);
+		const string &hint = corpus.documents[document_id];
+		AssertEqual(actual.size(), expected.size(), hint);
+		for (const auto &[word, freq] : expected)
+		{
+			const auto it = actual.find(word);
+			Assert(it != actual.end(), hint);
+			Assert(abs(it->second - freq) < 1e-12, hint);
+		}
+	}
+
+	// a text of stop words and delimiters only is a document without words
+	const string stop_text = "  "s + corpus.stop_words + "\t"s + corpus.stop_words + " "s;
+	server.AddDocument(DOCUMENT_COUNT, stop_text, DocumentStatus::ACTUAL, {1});
+	ASSERT(server.GetWordFrequencies(DOCUMENT_COUNT).empty());
+	ASSERT(server.FindTopDocuments(corpus.stop_words).empty());
+	ASSERT(server.GetWordFrequencies(DOCUMENT_COUNT + 1).empty());
+}
+
+void TestPreparedQueryMatchesRawQuery()
+{
+	const TestCorpus corpus = GenerateTestCorpus(DOCUMENT_COUNT, 50);
+	SearchServer server = MakeServer(corpus);
+	const auto is_even = [](int document_id, DocumentStatus, int)
+	{
+		return document_id % 2 == 0;
+	};
+
+	// one prepared query runs with every status, predicate and policy
+	for (const string &query : corpus.queries)
+	{
+		const PreparedQuery prepared = server.PrepareQuery(query);
+		AssertSameDocuments(server.FindTopDocuments(query), server.FindTopDocuments(prepared), query);
+		AssertSameDocuments(server.FindTopDocuments(query), server.FindTopDocuments(execution::par, prepared), query);
+		AssertSameDocuments(server.FindTopDocuments(query, DocumentStatus::BANNED, 20), server.FindTopDocuments(prepared, DocumentStatus::BANNED, 20), query);
+		AssertSameDocuments(server.FindTopDocuments(query, is_even), server.FindTopDocuments(execution::par, prepared, is_even), query);
+		for (int document_id = 0; document_id < DOCUMENT_COUNT; document_id += 25)
+		{
+			const auto [expected_words, expected_status] = server.MatchDocument(query, document_id);
+			for (const auto &[words, status] : {server.MatchDocument(prepared, document_id), server.MatchDocument(execution::par, prepared, document_id)})
+			{
+				AssertEqual(words, expected_words, query);
+				Assert(status == expected_status, query);
+			}
+		}
+	}
+
+	// a query is prepared for one state of one server
+	const PreparedQuery prepared = server.PrepareQuery(corpus.queries[0]);
+	const SearchServer copy = server;
+	ASSERT_THROWS((void)copy.FindTopDocuments(prepared), invalid_argument);
+	server.RemoveDocument(1);
+	ASSERT_THROWS((void)server.FindTopDocuments(prepared), invalid_argument);
+	ASSERT_THROWS((void)server.MatchDocument(prepared, 2), invalid_argument);
+	ASSERT_THROWS((void)server.FindTopDocuments(PreparedQuery()), invalid_argument);
+	ASSERT_DOESNT_THROW((void)server.FindTopDocuments(server.PrepareQuery(corpus.queries[0])));
+}
+
+void TestMinusWordsExcludeDocuments()
+{
+	const TestCorpus corpus = GenerateTestCorpus(DOCUMENT_COUNT, 100);
+	SearchServer server = MakeServer(corpus);
+	for (int document_id = 0; document_id < DOCUMENT_COUNT; document_id += 6)
+	{
+		server.RemoveDocument(document_id);
+	}
+
+	// a query finds what its plus words find, less the documents with a minus word, scored alike
+	for (const string &query : corpus.queries)
+	{
+		string plus_query;
+		vector<string> minus_words;
+		for (const string &word : SplitReferenceWords(query))
+		{
+			if (word[0] == '-')
+			{
+				minus_words.push_back(word.substr(1));
+			}
+			else
+			{
+				plus_query += word + ' ';
+			}
+		}
+		const auto has_no_minus_word = [&server, &minus_words](int document_id)
+		{
+			const map<string_view, double> freqs = server.GetWordFrequencies(document_id);
+			return none_of(minus_words.begin(), minus_words.end(), [&freqs](const string &word)
+						   { return freqs.count(word) > 0; });
+		};
+		vector<Document> expected;
+		for (const Document &document : server.FindTopDocuments(plus_query, DocumentStatus::ACTUAL, DOCUMENT_COUNT))
+		{
+			if (has_no_minus_word(document.id))
+			{
+				expected.push_back(document);
+			}
+		}
+		AssertSameDocuments(expected, server.FindTopDocuments(query, DocumentStatus::ACTUAL, DOCUMENT_COUNT), query);
+		AssertSameDocuments(expected, server.FindTopDocuments(execution::par, query, DocumentStatus::ACTUAL, DOCUMENT_COUNT), query);
+		for (const Document &document : expected)
+		{
+			Assert(!get<0>(server.MatchDocument(query, document.id)).empty(), query);
+		}
+	}
+
+	// a minus word beats the same plus word, absent and stop minus words exclude nothing
+	SearchServer small("in"s);
+	small.AddDocument(1, "cat in town"sv, DocumentStatus::ACTUAL, {1});
+	small.AddDocument(2, "dog in town"sv, DocumentStatus::ACTUAL, {1});
+	ASSERT(small.FindTopDocuments("cat -cat"sv).empty());
+	ASSERT_EQUAL(small.FindTopDocuments("town -cat"sv).size(), 1u);
+	ASSERT_EQUAL(small.FindTopDocuments("town -bird -in"sv).size(), 2u);
+	ASSERT(get<0>(small.MatchDocument("town -cat"sv, 1)).empty());
+	ASSERT_EQUAL(get<0>(small.MatchDocument(execution::par, "town -dog"sv, 1)), (vector<string_view>{"town"sv}));
+}
+
+void TestAddDocumentsMatchesAddDocument()
+{
+	const TestCorpus corpus = GenerateTestCorpus(DOCUMENT_COUNT, 50);
+	const SearchServer expected = MakeServer(corpus);
+	const vector<RawDocument> first_half = MakeRawDocuments(corpus, 0, DOCUMENT_COUNT / 2);
+	const vector<RawDocument> second_half = MakeRawDocuments(corpus, DOCUMENT_COUNT / 2, DOCUMENT_COUNT);
+
+	// the second batch goes to a server that already has terms and documents
+	SearchServer seq(corpus.stop_words);
+	seq.AddDocuments(execution::seq, first_half);
+	seq.AddDocuments(execution::seq, second_half);
+	AssertSameServers(expected, seq, corpus, "seq"s);
+
+	SearchServer par(corpus.stop_words);
+	par.AddDocuments(execution::par, first_half);
+	par.AddDocuments(execution::par, second_half);
+	AssertSameServers(expected, par, corpus, "par"s);
+
+	// a batch with an invalid document adds nothing
+	vector<RawDocument> invalid = MakeRawDocuments(corpus, DOCUMENT_COUNT, DOCUMENT_COUNT);
+	invalid.push_back({DOCUMENT_COUNT, "new words"sv, DocumentStatus::ACTUAL, {1}});
+	invalid.push_back({DOCUMENT_COUNT + 1, "bad\x01word"sv, DocumentStatus::ACTUAL, {1}});
+	ASSERT_THROWS(par.AddDocuments(execution::par, invalid), invalid_argument);
+	ASSERT_THROWS(seq.AddDocuments(execution::seq, invalid), invalid_argument);
+	invalid.back().id = 0;
+	invalid.back().text = "word"sv;
+	ASSERT_THROWS(par.AddDocuments(execution::par, invalid), invalid_argument);
+	AssertSameServers(expected, par, corpus, "invalid par"s);
+	AssertSameServers(expected, seq, corpus, "invalid seq"s);
+}
+
+void TestRemoveDocumentAndCompact()
+{
+	const TestCorpus corpus = GenerateTestCorpus(DOCUMENT_COUNT, 50);
+	SearchServer expected(corpus.stop_words);
+	for (int document_id = 0; document_id < DOCUMENT_COUNT; ++document_id)
+	{
+		if (document_id % 3 != 0)
+		{
+			expected.AddDocument(document_id, corpus.documents[document_id], GetTestStatus(document_id), GetTestRatings(document_id));
+		}
+	}
+
+	SearchServer seq = MakeServer(corpus);
+	SearchServer par = MakeServer(corpus);
+	for (int document_id = 0; document_id < DOCUMENT_COUNT; document_id += 3)
+	{
+		seq.RemoveDocument(execution::seq, document_id);
+		par.RemoveDocument(execution::par, document_id);
+	}
+	// removing an absent document changes nothing
+	seq.RemoveDocument(execution::seq, DOCUMENT_COUNT);
+	par.RemoveDocument(execution::par, 0);
+	AssertSameServers(expected, seq, corpus, "removed seq"s);
+	AssertSameServers(expected, par, corpus, "removed par"s);
+	ASSERT_EQUAL(par.GetMemoryStats().removed_document_count, static_cast<size_t>(DOCUMENT_COUNT / 3 + 1));
+
+	par.Compact();
+	AssertSameServers(expected, par, corpus, "compacted"s);
+	const IndexMemoryStats stats = par.GetMemoryStats();
+	ASSERT_EQUAL(stats.removed_document_count, 0u);
+	ASSERT_EQUAL(stats.removed_posting_count, 0u);
+	ASSERT_EQUAL(stats.unused_term_count, 0u);
+	ASSERT_EQUAL(stats.posting_count, expected.GetMemoryStats().posting_count);
+
+	// the compacted server keeps taking changes
+	for (int document_id = 0; document_id < DOCUMENT_COUNT; document_id += 6)
+	{
+		expected.AddDocument(document_id, corpus.documents[document_id], GetTestStatus(document_id), GetTestRatings(document_id));
+		par.AddDocument(document_id, corpus.documents[document_id], GetTestStatus(document_id), GetTestRatings(document_id));
+		expected.RemoveDocument(document_id + 1);
+		par.RemoveDocument(document_id + 1);
+	}
+	AssertSameServers(expected, par, corpus, "changed after compaction"s);
+}
+
+void TestResultCacheInvalidation()
+{
+	const TestCorpus corpus = GenerateTestCorpus(DOCUMENT_COUNT, 50);
+	SearchServer expected = MakeServer(corpus);
+	SearchServer cached = MakeServer(corpus);
+	cached.SetResultCacheCapacity(1000);
+
+	const auto assert_cached = [&](const string &stage)
+	{
+		// the second round is served from the cache
+		for (int round = 0; round < 2; ++round)
+		{
+			for (const string &query : corpus.queries)
+			{
+				const string hint = stage + ": "s + query;
+				AssertSameDocuments(expected.FindTopDocuments(query), cached.FindTopDocuments(query), hint);
+				AssertSameDocuments(expected.FindTopDocuments(query, DocumentStatus::BANNED), cached.FindTopDocuments(execution::par, query, DocumentStatus::BANNED), hint);
+				AssertSameDocuments(expected.FindTopDocuments(query), cached.FindTopDocumentsAsync(query).get(), hint);
+			}
+		}
+	};
+	assert_cached("added"s);
+	QueryCacheStats stats = cached.GetResultCacheStats();
+	ASSERT(stats.hits >= 2 * corpus.queries.size());
+	ASSERT(stats.size > 0);
+
+	// documents matching every query change the results the cache holds
+	for (int document_id = DOCUMENT_COUNT; document_id < DOCUMENT_COUNT + 20; ++document_id)
+	{
+		const string &text = corpus.queries[document_id % corpus.queries.size()];
+		expected.AddDocument(document_id, text, GetTestStatus(document_id), {100});
+		cached.AddDocument(document_id, text, GetTestStatus(document_id), {100});
+	}
+	assert_cached("added again"s);
+
+	for (int document_id = DOCUMENT_COUNT; document_id < DOCUMENT_COUNT + 20; document_id += 2)
+	{
+		expected.RemoveDocument(document_id);
+		cached.RemoveDocument(document_id);
+	}
+	assert_cached("removed"s);
+
+	vector<RawDocument> batch;
+	for (int document_id = DOCUMENT_COUNT; document_id < DOCUMENT_COUNT + 20; document_id += 2)
+	{
+		batch.push_back({document_id, corpus.queries[0], DocumentStatus::ACTUAL, {-100}});
+	}
+	expected.AddDocuments(batch);
+	cached.AddDocuments(execution::par, batch);
+	assert_cached("added in a batch"s);
+
+	stats = cached.GetResultCacheStats();
+	ASSERT_EQUAL(stats.capacity, 1000u);
+	cached.SetResultCacheCapacity(0);
+	ASSERT_EQUAL(cached.GetResultCacheStats().size, 0u);
+	assert_cached("disabled"s);
+}
+
+void TestStatusFilter()
+{
+	const TestCorpus corpus = GenerateTestCorpus(DOCUMENT_COUNT, 50);
+	SearchServer server(corpus.stop_words);
+	for (int document_id = 0; document_id < DOCUMENT_COUNT; ++document_id)
+	{
+		server.AddDocument(document_id, corpus.documents[document_id], static_cast<DocumentStatus>(document_id % 3), GetTestRatings(document_id));
+	}
+	for (int document_id = 0; document_id < DOCUMENT_COUNT; document_id += 4)
+	{
+		server.RemoveDocument(document_id);
+	}
+
+	// the documents of a status are those its predicate accepts, removed ones are never found
+	for (const DocumentStatus status : {DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT, DocumentStatus::BANNED, DocumentStatus::REMOVED})
+	{
+		const auto has_status = [status](int, DocumentStatus document_status, int)
+		{
+			return document_status == status;
+		};
+		for (const string &query : corpus.queries)
+		{
+			const vector<Document> expected = server.FindTopDocuments(query, has_status, DOCUMENT_COUNT);
+			AssertSameDocuments(expected, server.FindTopDocuments(query, status, DOCUMENT_COUNT), query);
+			AssertSameDocuments(expected, server.FindTopDocuments(execution::par, query, status, DOCUMENT_COUNT), query);
+			AssertSameDocuments(expected, server.FindTopDocumentsAsync(query, status, DOCUMENT_COUNT).get(), query);
+			for (const Document &document : expected)
+			{
+				ASSERT(document.id % 4 != 0);
+				ASSERT_EQUAL(document.id % 3, static_cast<int>(status));
+			}
+		}
+	}
+}
+
+void TestPrunedMatchesExhaustive()
+{
+	// a term in most documents next to rare ones, over several scoring windows, is what
+	// MaxScore prunes once the collector is full
+	const int document_count = 30000;
+	const TestCorpus corpus = GenerateTestCorpus(document_count, 30);
+	SearchServer server(corpus.stop_words);
+	for (int document_id = 0; document_id < document_count; ++document_id)
+	{
+		const string prefix = document_id % 10 < 8 ? "common "s : ""s;
+		server.AddDocument(document_id, prefix + corpus.documents[document_id], GetTestStatus(document_id), GetTestRatings(document_id));
+	}
+
+	// no collector with room for every document is ever full, so nothing is pruned
+	for (const string &raw_query : corpus.queries)
+	{
+		const string query = "common "s + raw_query;
+		const vector<Document> all = server.FindTopDocuments(query, DocumentStatus::ACTUAL, SIZE_MAX);
+		for (const size_t top_count : {size_t{1}, size_t{5}, size_t{50}})
+		{
+			const vector<Document> expected(all.begin(), all.begin() + min(top_count, all.size()));
+			AssertSameDocuments(expected, server.FindTopDocuments(query, DocumentStatus::ACTUAL, top_count), query);
+			AssertSameDocuments(expected, server.FindTopDocuments(execution::par, query, DocumentStatus::ACTUAL, top_count), query);
+			AssertSameDocuments(expected, server.FindTopDocumentsAsync(query, DocumentStatus::ACTUAL, top_count).get(), query);
+		}
+	}
+}
+
+void TestProcessQueriesJoined()
+{
+	const TestCorpus corpus = GenerateTestCorpus(DOCUMENT_COUNT, 50);
+	const SearchServer server = MakeServer(corpus);
+
+	const vector<vector<Document>> expected = ProcessQueries(server, corpus.queries);
+	const JoinedQueryResults joined = ProcessQueriesJoined(server, corpus.queries);
+	ASSERT_EQUAL(joined.GetQueryCount(), corpus.queries.size());
+	vector<Document> flat;
+	for (size_t i = 0; i < corpus.queries.size(); ++i)
+	{
+		const auto results = joined.GetQueryResults(i);
+		AssertSameDocuments(expected[i], {results.begin(), results.end()}, corpus.queries[i]);
+		flat.insert(flat.end(), expected[i].begin(), expected[i].end());
+	}
+	AssertSameDocuments(flat, {joined.begin(), joined.end()}, "all queries"s);
+
+	// results longer than the default top count, and no results at all
+	const JoinedQueryResults long_results = ProcessQueriesJoined(server, corpus.queries, 40);
+	for (size_t i = 0; i < corpus.queries.size(); ++i)
+	{
+		const auto results = long_results.GetQueryResults(i);
+		AssertSameDocuments(server.FindTopDocuments(corpus.queries[i], DocumentStatus::ACTUAL, 40), {results.begin(), results.end()}, corpus.queries[i]);
+	}
+	ASSERT(ProcessQueriesJoined(server, corpus.queries, 0).empty());
+	ASSERT_EQUAL(ProcessQueriesJoined(server, {}).GetQueryCount(), 0u);
+	ASSERT_THROWS(ProcessQueriesJoined(server, {corpus.queries[0], "--bad"s}), invalid_argument);
+}
+
+void TestAsyncMatchesSync()
+{
+	const TestCorpus corpus = GenerateTestCorpus(DOCUMENT_COUNT, 100);
+	SearchServer server = MakeServer(corpus);
+	// a pool of its own, with fewer threads than queries in flight
+	server.SetThreadPool(make_shared<ThreadPool>(2));
+	const auto is_even = [](int document_id, DocumentStatus, int)
+	{
+		return document_id % 2 == 0;
+	};
+
+	vector<future<vector<Document>>> by_status;
+	vector<future<vector<Document>>> by_predicate;
+	for (const string &query : corpus.queries)
+	{
+		by_status.push_back(server.FindTopDocumentsAsync(query, DocumentStatus::BANNED, 10));
+		by_predicate.push_back(server.FindTopDocumentsAsync(query, is_even));
+	}
+	auto invalid = server.FindTopDocumentsAsync("cat --dog"s);
+	for (size_t i = 0; i < corpus.queries.size(); ++i)
+	{
+		const string &query = corpus.queries[i];
+		AssertSameDocuments(server.FindTopDocuments(query, DocumentStatus::BANNED, 10), by_status[i].get(), query);
+		AssertSameDocuments(server.FindTopDocuments(query, is_even), by_predicate[i].get(), query);
+	}
+	ASSERT_THROWS(invalid.get(), invalid_argument);
+}
+
+int main()
+{
+	TestRunner tr;
+	RUN_TEST(tr, TestUnboundedTopCount);
+	RUN_TEST(tr, TestMatchesReferenceRanking);
+	RUN_TEST(tr, TestScoresDoNotLeakBetweenQueries);
+	RUN_TEST(tr, TestIdfFollowsChanges);
+	RUN_TEST(tr, TestWordFrequenciesSkipStopWords);
+	RUN_TEST(tr, TestPreparedQueryMatchesRawQuery);
+	RUN_TEST(tr, TestMinusWordsExcludeDocuments);
+	RUN_TEST(tr, TestAddDocumentsMatchesAddDocument);
+	RUN_TEST(tr, TestRemoveDocumentAndCompact);
+	RUN_TEST(tr, TestResultCacheInvalidation);
+	RUN_TEST(tr, TestStatusFilter);
+	RUN_TEST(tr, TestPrunedMatchesExhaustive);
+	RUN_TEST(tr, TestProcessQueriesJoined);
+	RUN_TEST(tr, TestAsyncMatchesSync);
+}
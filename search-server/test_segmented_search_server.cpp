@@ -0,0 +1,114 @@
+#include "search_server.h"
+#include "segmented_search_server.h"
+#include "test_corpus.h"
+#include "test_framework.h"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+	const int DOCUMENT_COUNT = 300;
+
+	void AssertSameResults(const SearchServer &expected, const SegmentedSearchServer &actual, const TestCorpus &corpus, const string &stage)
+	{
+		ASSERT_EQUAL(actual.GetDocumentCount(), expected.GetDocumentCount());
+		for (const string &query : corpus.queries)
+		{
+			const string hint = stage + ": "s + query;
+			AssertSameDocuments(expected.FindTopDocuments(query), actual.FindTopDocuments(query), hint);
+			AssertSameDocuments(expected.FindTopDocuments(query, DocumentStatus::BANNED, 20), actual.FindTopDocuments(query, DocumentStatus::BANNED, 20), hint);
+			const auto is_even = [](int document_id, DocumentStatus, int)
+			{
+				return document_id % 2 == 0;
+			};
+			AssertSameDocuments(expected.FindTopDocuments(query, is_even), actual.FindTopDocuments(query, is_even), hint);
+		}
+	}
+
+	template <typename Server>
+	void AddDocuments(Server &server, const TestCorpus &corpus, int first_id, int last_id, int text_shift = 0)
+	{
+		for (int document_id = first_id; document_id < last_id; ++document_id)
+		{
+			const string &text = corpus.documents[(document_id + text_shift) % corpus.documents.size()];
+			server.AddDocument(document_id, text, GetTestStatus(document_id), GetTestRatings(document_id));
+		}
+	}
+}
+
+void TestSegmentedMatchesSingleServer()
+{
+	const TestCorpus corpus = GenerateTestCorpus(DOCUMENT_COUNT, 60);
+	SearchServer expected(corpus.stop_words);
+	SegmentMergePolicy policy;
+	policy.seal_document_count = 16;
+	policy.merge_factor = 2;
+	SegmentedSearchServer actual(SearchServer(corpus.stop_words), policy);
+
+	AddDocuments(expected, corpus, 0, DOCUMENT_COUNT);
+	AddDocuments(actual, corpus, 0, DOCUMENT_COUNT);
+	// merges may still be running
+	AssertSameResults(expected, actual, corpus, "added"s);
+	actual.WaitForMerges();
+	ASSERT(actual.GetSegmentCount() > 1);
+	AssertSameResults(expected, actual, corpus, "merged"s);
+
+	// tombstones of sealed segments are handed to the merges that drop them
+	for (int document_id = 0; document_id < DOCUMENT_COUNT; document_id += 3)
+	{
+		expected.RemoveDocument(document_id);
+		actual.RemoveDocument(document_id);
+	}
+	AssertSameResults(expected, actual, corpus, "removed"s);
+	actual.WaitForMerges();
+	AssertSameResults(expected, actual, corpus, "removed and merged"s);
+
+	// removed ids come back with other texts
+	for (int document_id = 0; document_id < DOCUMENT_COUNT; document_id += 3)
+	{
+		AddDocuments(expected, corpus, document_id, document_id + 1, 7);
+		AddDocuments(actual, corpus, document_id, document_id + 1, 7);
+	}
+	AssertSameResults(expected, actual, corpus, "re-added"s);
+	actual.Seal();
+	actual.WaitForMerges();
+	AssertSameResults(expected, actual, corpus, "re-added and merged"s);
+
+	// the old tombstoned copy of a re-added document may still sit in a sealed segment
+	for (int document_id = 0; document_id < DOCUMENT_COUNT; document_id += 6)
+	{
+		expected.RemoveDocument(document_id);
+		actual.RemoveDocument(document_id);
+	}
+	AssertSameResults(expected, actual, corpus, "removed again"s);
+	actual.WaitForMerges();
+	AssertSameResults(expected, actual, corpus, "removed again and merged"s);
+}
+
+void TestSegmentedRejectsDuplicates()
+{
+	const TestCorpus corpus = GenerateTestCorpus(40, 0);
+	SegmentMergePolicy policy;
+	policy.seal_document_count = 8;
+	SegmentedSearchServer server(SearchServer(corpus.stop_words), policy);
+	AddDocuments(server, corpus, 0, 40);
+
+	// an id is taken while its document lives in any segment
+	ASSERT_THROWS(server.AddDocument(3, "text"s, DocumentStatus::ACTUAL, {}), invalid_argument);
+	ASSERT_THROWS(server.AddDocument(39, "text"s, DocumentStatus::ACTUAL, {}), invalid_argument);
+	server.RemoveDocument(3);
+	server.RemoveDocument(3);
+	ASSERT_DOESNT_THROW(server.AddDocument(3, "text"s, DocumentStatus::ACTUAL, {}));
+	ASSERT_EQUAL(server.GetDocumentCount(), 40);
+}
+
+int main()
+{
+	TestRunner tr;
+	RUN_TEST(tr, TestSegmentedMatchesSingleServer);
+	RUN_TEST(tr, TestSegmentedRejectsDuplicates);
+}
@@ -0,0 +1,159 @@
+#include "search_server.h"
+#include "search_shard.h"
+#include "shard_protocol.h"
+#include "shard_server.h"
+#include "sharded_search_server.h"
+#include "test_corpus.h"
+#include "test_framework.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+	const int DOCUMENT_COUNT = 400;
+	const string SOCKET_PATH = (filesystem::temp_directory_path() / "search_server_test_shard.sock").string();
+
+	// A LocalSearchShard served over a Unix domain socket by a thread of its own
+	class ServedShard
+	{
+	public:
+		explicit ServedShard(const SearchServer &empty_index)
+			: shard_(empty_index), server_(shard_, SOCKET_PATH), thread_([this]
+																		 { server_.Run(); })
+		{
+		}
+
+		~ServedShard()
+		{
+			server_.Stop();
+			thread_.join();
+		}
+
+	private:
+		LocalSearchShard shard_;
+		ShardServer server_;
+		thread thread_;
+	};
+
+	void AssertSameResults(const SearchServer &expected, const ShardedSearchServer &actual, const TestCorpus &corpus, const string &stage)
+	{
+		ASSERT_EQUAL(actual.GetDocumentCount(), expected.GetDocumentCount());
+		for (const string &query : corpus.queries)
+		{
+			const string hint = stage + ": "s + query;
+			AssertSameDocuments(expected.FindTopDocuments(query), actual.FindTopDocuments(query), hint);
+			AssertSameDocuments(expected.FindTopDocuments(query, DocumentStatus::BANNED, 20), actual.FindTopDocuments(query, DocumentStatus::BANNED, 20), hint);
+		}
+	}
+
+	template <typename Server>
+	void AddDocuments(Server &server, const TestCorpus &corpus, int first_id, int last_id, int step = 1)
+	{
+		for (int document_id = first_id; document_id < last_id; document_id += step)
+		{
+			server.AddDocument(document_id, corpus.documents[document_id], GetTestStatus(document_id), GetTestRatings(document_id));
+		}
+	}
+}
+
+void TestShardedMatchesSingleServer()
+{
+	const TestCorpus corpus = GenerateTestCorpus(DOCUMENT_COUNT, 80);
+	const SearchServer empty_index(corpus.stop_words);
+	SearchServer expected = empty_index;
+	ServedShard served_shard(empty_index);
+
+	vector<unique_ptr<SearchShard>> shards;
+	shards.push_back(make_unique<LocalSearchShard>(empty_index));
+	shards.push_back(make_unique<RemoteSearchShard>(SOCKET_PATH));
+	shards.push_back(make_unique<LocalSearchShard>(empty_index));
+	ShardedSearchServer actual(move(shards));
+
+	AddDocuments(expected, corpus, 0, DOCUMENT_COUNT);
+	AddDocuments(actual, corpus, 0, DOCUMENT_COUNT);
+	AssertSameResults(expected, actual, corpus, "added"s);
+
+	for (int document_id = 0; document_id < DOCUMENT_COUNT; document_id += 4)
+	{
+		expected.RemoveDocument(document_id);
+		actual.RemoveDocument(document_id);
+	}
+	AssertSameResults(expected, actual, corpus, "removed"s);
+
+	AddDocuments(expected, corpus, 0, DOCUMENT_COUNT, 8);
+	AddDocuments(actual, corpus, 0, DOCUMENT_COUNT, 8);
+	AssertSameResults(expected, actual, corpus, "re-added"s);
+}
+
+void TestShardedReportsShardErrors()
+{
+	const TestCorpus corpus = GenerateTestCorpus(20, 0);
+	const SearchServer empty_index(corpus.stop_words);
+	ServedShard served_shard(empty_index);
+
+	vector<unique_ptr<SearchShard>> shards;
+	shards.push_back(make_unique<LocalSearchShard>(empty_index));
+	shards.push_back(make_unique<RemoteSearchShard>(SOCKET_PATH));
+	ShardedSearchServer server(move(shards));
+	AddDocuments(server, corpus, 0, 20);
+
+	// id 5 lives on the remote shard, whose std::invalid_argument crosses the socket as such
+	ASSERT_THROWS(server.AddDocument(5, "text"s, DocumentStatus::ACTUAL, {}), invalid_argument);
+	ASSERT_THROWS(server.AddDocument(6, "text"s, DocumentStatus::ACTUAL, {}), invalid_argument);
+	ASSERT_THROWS(server.AddDocument(-1, "text"s, DocumentStatus::ACTUAL, {}), invalid_argument);
+	ASSERT_THROWS((void)server.FindTopDocuments("--text"s), invalid_argument);
+	ASSERT_EQUAL(server.GetDocumentCount(), 20);
+
+	// the connection survives the errors
+	server.RemoveDocument(5);
+	ASSERT_DOESNT_THROW(server.AddDocument(5, "text"s, DocumentStatus::ACTUAL, {}));
+	ASSERT_EQUAL(server.FindTopDocuments("text"s).size(), 1u);
+}
+
+void TestShardedTopCountLimit()
+{
+	const TestCorpus corpus = GenerateTestCorpus(DOCUMENT_COUNT, 20);
+	const SearchServer empty_index(corpus.stop_words);
+	SearchServer expected = empty_index;
+	ServedShard served_shard(empty_index);
+
+	AddDocuments(expected, corpus, 0, DOCUMENT_COUNT);
+
+	// the coordinator caps a top_count asking for everything; its connection is closed
+	// before the next one, as the shard server serves one at a time
+	{
+		vector<unique_ptr<SearchShard>> shards;
+		shards.push_back(make_unique<LocalSearchShard>(empty_index));
+		shards.push_back(make_unique<RemoteSearchShard>(SOCKET_PATH));
+		ShardedSearchServer actual(move(shards));
+		AddDocuments(actual, corpus, 0, DOCUMENT_COUNT);
+		for (const string &query : corpus.queries)
+		{
+			AssertSameDocuments(expected.FindTopDocuments(query, DocumentStatus::ACTUAL, DOCUMENT_COUNT), actual.FindTopDocuments(query, DocumentStatus::ACTUAL, SIZE_MAX), query);
+		}
+	}
+
+	// a shard server refuses more than the cap, and keeps serving
+	RemoteSearchShard remote(SOCKET_PATH);
+	const string &query = corpus.queries[0];
+	const CollectionStatistics statistics = remote.GetQueryStatistics(query);
+	ASSERT_THROWS((void)remote.FindTopDocuments(query, statistics, DocumentStatus::ACTUAL, MAX_SHARD_TOP_COUNT + 1), runtime_error);
+	ASSERT_THROWS((void)remote.FindTopDocuments(query, statistics, DocumentStatus::ACTUAL, SIZE_MAX), runtime_error);
+	ASSERT_DOESNT_THROW((void)remote.FindTopDocuments(query, statistics, DocumentStatus::ACTUAL, MAX_SHARD_TOP_COUNT));
+}
+
+int main()
+{
+	TestRunner tr;
+	RUN_TEST(tr, TestShardedMatchesSingleServer);
+	RUN_TEST(tr, TestShardedReportsShardErrors);
+	RUN_TEST(tr, TestShardedTopCountLimit);
+}
@@ -0,0 +1,172 @@
+#include "search_server.h"
+#include "snapshot_search_server.h"
+#include "test_corpus.h"
+#include "test_framework.h"
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+	const int BATCH_SIZE = 20;
+	const int REMOVED_PER_BATCH = 5;
+	const int BATCH_COUNT = 30;
+
+	// A version is published after every batch: BATCH_SIZE documents are added and the
+	// oldest REMOVED_PER_BATCH live ones removed
+	template <typename Server>
+	void ApplyBatch(Server &server, const TestCorpus &corpus, int batch)
+	{
+		for (int document_id = batch * BATCH_SIZE; document_id < (batch + 1) * BATCH_SIZE; ++document_id)
+		{
+			server.AddDocument(document_id, corpus.documents[document_id], GetTestStatus(document_id), GetTestRatings(document_id));
+		}
+		for (int document_id = batch * REMOVED_PER_BATCH; document_id < (batch + 1) * REMOVED_PER_BATCH; ++document_id)
+		{
+			server.RemoveDocument(document_id);
+		}
+	}
+
+	// Results of the queries in a published version, which has a document count of its own
+	struct Version
+	{
+		int document_count = 0;
+		vector<vector<Document>> results;
+	};
+
+	vector<Document> FindAll(const SearchServer &server, const string &query)
+	{
+		return server.FindTopDocuments(query, DocumentStatus::ACTUAL, BATCH_COUNT * BATCH_SIZE);
+	}
+
+	vector<Version> ComputeVersions(const SearchServer &empty_server, const TestCorpus &corpus)
+	{
+		SearchServer server = empty_server;
+		vector<Version> versions;
+		for (int batch = -1; batch < BATCH_COUNT; ++batch)
+		{
+			if (batch >= 0)
+			{
+				ApplyBatch(server, corpus, batch);
+			}
+			Version &version = versions.emplace_back();
+			version.document_count = server.GetDocumentCount();
+			for (const string &query : corpus.queries)
+			{
+				version.results.push_back(FindAll(server, query));
+			}
+		}
+		return versions;
+	}
+}
+
+void TestSnapshotKeepsItsVersion()
+{
+	const TestCorpus corpus = GenerateTestCorpus(10, 5);
+	SnapshotSearchServer server(SearchServer(corpus.stop_words));
+
+	auto before = server.GetSnapshot();
+	server.AddDocument(1, corpus.documents[1], DocumentStatus::ACTUAL, {1});
+	server.AddDocument(2, corpus.documents[2], DocumentStatus::ACTUAL, {2});
+	ASSERT_EQUAL(before->GetDocumentCount(), 0);
+	ASSERT_EQUAL(server.GetSnapshot()->GetDocumentCount(), 0);
+
+	server.Publish();
+	auto after = server.GetSnapshot();
+	ASSERT_EQUAL(before->GetDocumentCount(), 0);
+	ASSERT_EQUAL(after->GetDocumentCount(), 2);
+
+	// the next change waits for the snapshots of the copy it replays the changes on
+	before.reset();
+	server.RemoveDocument(1);
+	ASSERT_EQUAL(after->GetDocumentCount(), 2);
+	ASSERT(after->HasDocument(1));
+	after.reset();
+	server.Publish();
+	ASSERT_EQUAL(server.GetSnapshot()->GetDocumentCount(), 1);
+	ASSERT(!server.GetSnapshot()->HasDocument(1));
+
+	// invalid changes throw and are not published
+	ASSERT_THROWS(server.AddDocument(2, "duplicate"s, DocumentStatus::ACTUAL, {}), invalid_argument);
+	server.Publish();
+	ASSERT_EQUAL(server.GetSnapshot()->GetDocumentCount(), 1);
+}
+
+void TestReadersDuringPublish()
+{
+	const TestCorpus corpus = GenerateTestCorpus(BATCH_COUNT * BATCH_SIZE, 5);
+	const SearchServer empty_server(corpus.stop_words);
+	const vector<Version> versions = ComputeVersions(empty_server, corpus);
+	SnapshotSearchServer server(empty_server);
+
+	atomic<bool> is_writing = true;
+	atomic<int> failure_count = 0;
+	atomic<int> read_count = 0;
+	const auto read = [&]
+	{
+		do
+		{
+			const auto snapshot = server.GetSnapshot();
+			const int document_count = snapshot->GetDocumentCount();
+			const auto version = find_if(versions.begin(), versions.end(),
+										 [document_count](const Version &version)
+										 {
+											 return version.document_count == document_count;
+										 });
+			if (version == versions.end())
+			{
+				++failure_count;
+				continue;
+			}
+			// a version is seen whole, and it does not change while the snapshot is held
+			for (size_t i = 0; i < corpus.queries.size(); ++i)
+			{
+				const vector<Document> found = FindAll(*snapshot, corpus.queries[i]);
+				const vector<Document> &expected = version->results[i];
+				if (found.size() != expected.size() ||
+					!equal(found.begin(), found.end(), expected.begin(),
+						   [](const Document &lhs, const Document &rhs)
+						   {
+							   return lhs.id == rhs.id && lhs.relevance == rhs.relevance && lhs.rating == rhs.rating;
+						   }))
+				{
+					++failure_count;
+				}
+			}
+			++read_count;
+		} while (is_writing);
+	};
+
+	vector<thread> readers;
+	for (int i = 0; i < 3; ++i)
+	{
+		readers.emplace_back(read);
+	}
+	for (int batch = 0; batch < BATCH_COUNT; ++batch)
+	{
+		ApplyBatch(server, corpus, batch);
+		server.Publish();
+	}
+	is_writing = false;
+	for (thread &reader : readers)
+	{
+		reader.join();
+	}
+
+	ASSERT_EQUAL(failure_count.load(), 0);
+	ASSERT(read_count.load() >= 3);
+	ASSERT_EQUAL(server.GetSnapshot()->GetDocumentCount(), versions.back().document_count);
+}
+
+int main()
+{
+	TestRunner tr;
+	RUN_TEST(tr, TestSnapshotKeepsItsVersion);
+	RUN_TEST(tr, TestReadersDuringPublish);
+}
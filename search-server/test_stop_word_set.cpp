@@ -0,0 +1,72 @@
+#include "search_server.h"
+#include "stop_word_set.h"
+#include "test_framework.h"
+
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+void TestStopWordSetMatchesSet()
+{
+	// enough words to grow the table several times
+	vector<string> words;
+	for (int i = 0; i < 1000; ++i)
+	{
+		words.push_back("w"s + to_string(i * 7));
+	}
+	const StopWordSet stop_words(words);
+	const set<string> expected(words.begin(), words.end());
+	ASSERT_EQUAL(stop_words.size(), words.size());
+	for (size_t index = 0; index < words.size(); ++index)
+	{
+		ASSERT_EQUAL(stop_words.GetWord(index), words[index]);
+	}
+
+	// prefixes, extensions and neighbours of the words
+	for (int i = 0; i < 7000; ++i)
+	{
+		const string word = "w"s + to_string(i);
+		ASSERT_EQUAL(stop_words.Contains(word), expected.count(word) > 0);
+		ASSERT(!stop_words.Contains(word + "x"s));
+	}
+	ASSERT(!stop_words.Contains("w"sv));
+	ASSERT(!stop_words.Contains(""sv));
+	ASSERT(!StopWordSet().Contains("w0"sv));
+}
+
+void TestStopWordSetSkipsEmptyAndDuplicates()
+{
+	const StopWordSet stop_words(vector<string>{"and"s, ""s, "in"s, "and"s, ""s, "in"s, "at"s});
+	ASSERT_EQUAL(stop_words.size(), 3u);
+	ASSERT_EQUAL(stop_words.GetWord(0), "and"sv);
+	ASSERT_EQUAL(stop_words.GetWord(1), "in"sv);
+	ASSERT_EQUAL(stop_words.GetWord(2), "at"sv);
+	ASSERT(stop_words.Contains("at"sv));
+	ASSERT(!stop_words.Contains(""sv));
+}
+
+void TestServerStopWords()
+{
+	SearchServer server("  in the\tand in "s);
+	server.AddDocument(1, "cat in the city"sv, DocumentStatus::ACTUAL, {1});
+	server.AddDocument(2, "the and in"sv, DocumentStatus::ACTUAL, {1});
+	ASSERT_EQUAL(server.GetWordFrequencies(1).size(), 2u);
+	ASSERT(server.GetWordFrequencies(2).empty());
+	ASSERT(server.FindTopDocuments("in the"sv).empty());
+	ASSERT_EQUAL(server.FindTopDocuments("cat -the"sv).size(), 1u);
+
+	ASSERT_THROWS(SearchServer(vector<string>{"in"s, "t\x01he"s}), invalid_argument);
+	ASSERT_THROWS(SearchServer("in t\x02he"s), invalid_argument);
+}
+
+int main()
+{
+	TestRunner tr;
+	RUN_TEST(tr, TestStopWordSetMatchesSet);
+	RUN_TEST(tr, TestStopWordSetSkipsEmptyAndDuplicates);
+	RUN_TEST(tr, TestServerStopWords);
+}
@@ -0,0 +1,122 @@
+#include "term_dictionary.h"
+#include "test_framework.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+	vector<string> MakeTerms(size_t count)
+	{
+		vector<string> terms;
+		for (size_t i = 0; i < count; ++i)
+		{
+			terms.push_back("term"s + to_string(i));
+		}
+		return terms;
+	}
+
+	// The layout of an index file: concatenated texts, their offsets and a table of
+	// TermId + 1 probed linearly from Hash(term)
+	struct MappedTerms
+	{
+		string chars;
+		vector<uint64_t> offsets{0};
+		vector<uint32_t> table;
+
+		MappedTerms(const vector<string> &terms, size_t table_size)
+			: table(table_size)
+		{
+			for (size_t i = 0; i < terms.size(); ++i)
+			{
+				chars += terms[i];
+				offsets.push_back(chars.size());
+				size_t pos = TermDictionary::Hash(terms[i]) & (table_size - 1);
+				while (table[pos] != 0)
+				{
+					pos = (pos + 1) & (table_size - 1);
+				}
+				table[pos] = static_cast<uint32_t>(i + 1);
+			}
+		}
+	};
+}
+
+void TestInternAndFind()
+{
+	// enough terms to rehash the table many times, the interned texts stay in place
+	const vector<string> terms = MakeTerms(5000);
+	TermDictionary dictionary;
+	vector<string_view> views;
+	for (size_t i = 0; i < terms.size(); ++i)
+	{
+		ASSERT_EQUAL(dictionary.Intern(terms[i]), static_cast<TermId>(i));
+		views.push_back(dictionary.GetTerm(static_cast<TermId>(i)));
+	}
+	ASSERT_EQUAL(dictionary.size(), terms.size());
+	for (size_t i = 0; i < terms.size(); ++i)
+	{
+		ASSERT_EQUAL(dictionary.Intern(terms[i]), static_cast<TermId>(i));
+		ASSERT_EQUAL(*dictionary.Find(terms[i]), static_cast<TermId>(i));
+		ASSERT_EQUAL(views[i], terms[i]);
+	}
+	ASSERT(!dictionary.Find("absent"sv));
+	ASSERT(!dictionary.Find(""sv));
+	ASSERT_EQUAL(dictionary.size(), terms.size());
+
+	// a copy looks up its own texts, it outlives the original
+	TermDictionary copy;
+	{
+		TermDictionary original = dictionary;
+		copy = original;
+		original.Intern("new"sv);
+	}
+	ASSERT_EQUAL(copy.size(), terms.size());
+	ASSERT_EQUAL(*copy.Find(terms[42]), TermId{42});
+	ASSERT(!copy.Find("new"sv));
+	ASSERT_EQUAL(copy.Intern("new"sv), static_cast<TermId>(terms.size()));
+}
+
+void TestMappedTerms()
+{
+	const vector<string> terms = MakeTerms(100);
+	const MappedTerms mapped(terms, 256);
+	TermDictionary dictionary;
+	dictionary.Intern("dropped"sv);
+	dictionary.AttachMapped(mapped.chars.data(), mapped.offsets.data(), terms.size(), mapped.table.data(), mapped.table.size());
+	ASSERT_EQUAL(dictionary.size(), terms.size());
+	ASSERT(!dictionary.Find("dropped"sv));
+	for (size_t i = 0; i < terms.size(); ++i)
+	{
+		ASSERT_EQUAL(*dictionary.Find(terms[i]), static_cast<TermId>(i));
+		ASSERT_EQUAL(dictionary.GetTerm(static_cast<TermId>(i)), terms[i]);
+	}
+
+	// terms interned afterwards follow the mapped ones, and a copy keeps both
+	ASSERT_EQUAL(dictionary.Intern(terms[7]), TermId{7});
+	ASSERT_EQUAL(dictionary.Intern("extra"sv), static_cast<TermId>(terms.size()));
+	const TermDictionary copy = dictionary;
+	ASSERT_EQUAL(*copy.Find(terms[99]), TermId{99});
+	ASSERT_EQUAL(*copy.Find("extra"sv), static_cast<TermId>(terms.size()));
+	ASSERT_EQUAL(copy.GetTerm(static_cast<TermId>(terms.size())), "extra"sv);
+}
+
+void TestHashIsStable()
+{
+	// 64-bit FNV-1a, the hash tables of saved index files depend on it
+	ASSERT_EQUAL(TermDictionary::Hash(""sv), 14695981039346656037ULL);
+	ASSERT_EQUAL(TermDictionary::Hash("a"sv), 0xaf63dc4c8601ec8cULL);
+	ASSERT_EQUAL(TermDictionary::Hash("foobar"sv), 0x85944171f73967e8ULL);
+}
+
+int main()
+{
+	TestRunner tr;
+	RUN_TEST(tr, TestInternAndFind);
+	RUN_TEST(tr, TestMappedTerms);
+	RUN_TEST(tr, TestHashIsStable);
+}
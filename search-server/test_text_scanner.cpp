@@ -0,0 +1,137 @@
+#include "search_server.h"
+#include "string_processing.h"
+#include "test_framework.h"
+#include "text_scanner.h"
+
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+	const vector<TextScanKernel> KERNELS = {TextScanKernel::SCALAR, TextScanKernel::SSE2, TextScanKernel::AVX2};
+
+	// Reference split: words are runs of bytes that are neither spaces nor \t \n \v \f \r
+	vector<string_view> SplitSlowly(string_view text)
+	{
+		const auto is_delimiter = [](char c)
+		{
+			return c == ' ' || (c >= '\t' && c <= '\r');
+		};
+		vector<string_view> words;
+		size_t first = 0;
+		for (size_t i = 0; i <= text.size(); ++i)
+		{
+			if (i == text.size() || is_delimiter(text[i]))
+			{
+				if (i > first)
+				{
+					words.push_back(text.substr(first, i - first));
+				}
+				first = i + 1;
+			}
+		}
+		return words;
+	}
+}
+
+void TestScanKernelsClassifyAlike()
+{
+	ASSERT(IsTextScanKernelSupported(TextScanKernel::SCALAR));
+	// every byte value at every position of a block, then random blocks of every length
+	string block(TEXT_BLOCK_SIZE, 'a');
+	vector<string> blocks;
+	for (int c = 0; c < 256; ++c)
+	{
+		for (size_t position = 0; position < TEXT_BLOCK_SIZE; position += 7)
+		{
+			block[position] = static_cast<char>(c);
+			blocks.push_back(block);
+			block[position] = 'a';
+		}
+	}
+	const size_t full_block_count = blocks.size();
+	mt19937 generator(7);
+	for (int i = 0; i < 1000; ++i)
+	{
+		for (char &c : block)
+		{
+			c = static_cast<char>(uniform_int_distribution<int>(0, 255)(generator));
+		}
+		blocks.push_back(block);
+	}
+
+	for (const TextScanKernel kernel : KERNELS)
+	{
+		if (!IsTextScanKernelSupported(kernel))
+		{
+			continue;
+		}
+		for (size_t i = 0; i < blocks.size(); ++i)
+		{
+			const size_t size = i < full_block_count ? TEXT_BLOCK_SIZE : i % (TEXT_BLOCK_SIZE + 1);
+			const TextBlockMasks expected = ScanTextBlock(blocks[i].data(), size, TextScanKernel::SCALAR);
+			const TextBlockMasks actual = ScanTextBlock(blocks[i].data(), size, kernel);
+			ASSERT_EQUAL(actual.delimiters, expected.delimiters);
+			ASSERT_EQUAL(actual.invalid, expected.invalid);
+		}
+	}
+
+	const TextBlockMasks masks = ScanTextBlock("a\tb\nc\x01\x7f\x80 \v\f\r", 12);
+	ASSERT_EQUAL(masks.delimiters, ~uint64_t{0} << 12 | 0b111100001010u);
+	ASSERT_EQUAL(masks.invalid, 0b100000u);
+}
+
+void TestWordRangeDelimiters()
+{
+	ASSERT_EQUAL(SplitIntoWords("  cat\tdog\n\nbird\r\nfish\vox\f  "sv), (vector<string_view>{"cat"sv, "dog"sv, "bird"sv, "fish"sv, "ox"sv}));
+	ASSERT(SplitIntoWords(" \t\n"sv).empty());
+
+	// words and delimiter runs straddling block boundaries
+	mt19937 generator(11);
+	const string alphabet = "ab \t\n\r\x01"s;
+	for (int i = 0; i < 300; ++i)
+	{
+		string text(uniform_int_distribution<size_t>(0, 4 * TEXT_BLOCK_SIZE)(generator), 'a');
+		for (char &c : text)
+		{
+			c = alphabet[uniform_int_distribution<size_t>(0, alphabet.size() - 1)(generator)];
+		}
+		const vector<string_view> expected = SplitSlowly(text);
+		ASSERT_EQUAL(SplitIntoWords(string_view(text)), expected);
+
+		const WordRange words(text);
+		size_t k = 0;
+		for (auto it = words.begin(); it != words.end(); ++it, ++k)
+		{
+			ASSERT_EQUAL(it.HasControlCharacters(), it->find('\x01') != string_view::npos);
+		}
+		ASSERT_EQUAL(k, expected.size());
+	}
+}
+
+void TestControlCharactersRejected()
+{
+	SearchServer server("and"s);
+	server.AddDocument(1, "cat\tand\ndog"sv, DocumentStatus::ACTUAL, {1});
+	ASSERT_EQUAL(server.FindTopDocuments("dog\tcat"sv).size(), 1u);
+	// a control character past the first block of the text
+	const string long_prefix(2 * TEXT_BLOCK_SIZE, ' ');
+	ASSERT_THROWS(server.AddDocument(2, "cat d\x02og"sv, DocumentStatus::ACTUAL, {1}), invalid_argument);
+	ASSERT_THROWS(server.AddDocument(2, long_prefix + "cat d\x1fog"s, DocumentStatus::ACTUAL, {1}), invalid_argument);
+	ASSERT_THROWS((void)server.FindTopDocuments("cat \x03"sv), invalid_argument);
+	ASSERT_THROWS((void)server.FindTopDocuments(long_prefix + "-d\x10og"s), invalid_argument);
+	ASSERT_EQUAL(server.GetDocumentCount(), 1);
+}
+
+int main()
+{
+	TestRunner tr;
+	RUN_TEST(tr, TestScanKernelsClassifyAlike);
+	RUN_TEST(tr, TestWordRangeDelimiters);
+	RUN_TEST(tr, TestControlCharactersRejected);
+}
@@ -0,0 +1,120 @@
+#include "test_framework.h"
+#include "thread_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+	// Posts a task that posts the next one, depth times, and fulfils the promise at the end
+	void PostChain(ThreadPool &thread_pool, int depth, const shared_ptr<promise<int>> &result)
+	{
+		thread_pool.Post([&thread_pool, depth, result]
+						 {
+							 if (depth == 0)
+							 {
+								 result->set_value(42);
+								 return;
+							 }
+							 PostChain(thread_pool, depth - 1, result);
+						 });
+	}
+}
+
+void TestDestructorRunsQueuedTasks()
+{
+	atomic<int> run_count = 0;
+	vector<future<int>> futures;
+	{
+		ThreadPool thread_pool(2);
+		// workers that are asleep when the pool is destroyed wake up to find it stopping
+		// with the tasks still queued
+		this_thread::sleep_for(chrono::milliseconds(10));
+		for (int i = 0; i < 100; ++i)
+		{
+			auto result = make_shared<promise<int>>();
+			futures.push_back(result->get_future());
+			thread_pool.Post([&run_count, result, i]
+							 {
+								 this_thread::sleep_for(chrono::microseconds(100));
+								 ++run_count;
+								 result->set_value(i);
+							 });
+		}
+		for (int i = 0; i < 10; ++i)
+		{
+			auto result = make_shared<promise<int>>();
+			futures.push_back(result->get_future());
+			PostChain(thread_pool, 20, result);
+		}
+	}
+	ASSERT_EQUAL(run_count.load(), 100);
+	for (size_t i = 0; i < futures.size(); ++i)
+	{
+		ASSERT(futures[i].wait_for(chrono::seconds(0)) == future_status::ready);
+		ASSERT_EQUAL(futures[i].get(), i < 100 ? static_cast<int>(i) : 42);
+	}
+}
+
+void TestDestructorRunsLastTask()
+{
+	// a task posted right before the destruction is the one a sleeping worker may miss
+	int run_count = 0;
+	for (int i = 0; i < 1000; ++i)
+	{
+		atomic<bool> is_run = false;
+		{
+			ThreadPool thread_pool(2);
+			this_thread::sleep_for(chrono::microseconds(500));
+			thread_pool.Post([&is_run]
+							 { is_run = true; });
+		}
+		run_count += is_run ? 1 : 0;
+	}
+	ASSERT_EQUAL(run_count, 1000);
+}
+
+void TestParallelForRethrows()
+{
+	ThreadPool thread_pool(3);
+	vector<atomic<int>> calls(1000);
+	thread_pool.ParallelFor(calls.size(), [&calls](size_t index)
+							{ ++calls[index]; });
+	for (const atomic<int> &call_count : calls)
+	{
+		ASSERT_EQUAL(call_count.load(), 1);
+	}
+	ASSERT_THROWS(thread_pool.ParallelFor(100, [](size_t index)
+										  {
+											  if (index == 50)
+											  {
+												  throw runtime_error("task failed"s);
+											  }
+										  }),
+				  runtime_error);
+
+	// no threads, everything runs on the caller
+	ThreadPool inline_pool(0);
+	int sum = 0;
+	inline_pool.ParallelFor(10, [&sum](size_t index)
+							{ sum += static_cast<int>(index); });
+	inline_pool.Post([&sum]
+					 { sum += 100; });
+	ASSERT_EQUAL(sum, 145);
+}
+
+int main()
+{
+	TestRunner tr;
+	RUN_TEST(tr, TestDestructorRunsQueuedTasks);
+	RUN_TEST(tr, TestDestructorRunsLastTask);
+	RUN_TEST(tr, TestParallelForRethrows);
+}
@@ -0,0 +1,149 @@
+#include "text_scanner.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define TEXT_SCANNER_X86_64
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+	using ScanFunction = TextBlockMasks (*)(const char *);
+
+	TextBlockMasks ScanScalar(const char *data)
+	{
+		TextBlockMasks masks{0, 0};
+		for (size_t i = 0; i < TEXT_BLOCK_SIZE; ++i)
+		{
+			const auto c = static_cast<unsigned char>(data[i]);
+			if (c == ' ' || (c >= '\t' && c <= '\r'))
+			{
+				masks.delimiters |= uint64_t{1} << i;
+			}
+			else if (c < ' ')
+			{
+				masks.invalid |= uint64_t{1} << i;
+			}
+		}
+		return masks;
+	}
+
+#ifdef TEXT_SCANNER_X86_64
+	// SSE2 is part of x86-64, so this kernel needs no runtime check
+	TextBlockMasks ScanSse2(const char *data)
+	{
+		const __m128i space = _mm_set1_epi8(' ');
+		const __m128i before_tab = _mm_set1_epi8('\t' - 1);
+		const __m128i after_return = _mm_set1_epi8('\r' + 1);
+		const __m128i minus_one = _mm_set1_epi8(-1);
+
+		TextBlockMasks masks{0, 0};
+		for (size_t offset = 0; offset < TEXT_BLOCK_SIZE; offset += 16)
+		{
+			const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + offset));
+			// bytes are signed here, so non-ASCII bytes are excluded from the controls explicitly
+			const __m128i control = _mm_and_si128(_mm_cmplt_epi8(chars, space), _mm_cmpgt_epi8(chars, minus_one));
+			const __m128i whitespace = _mm_and_si128(_mm_cmpgt_epi8(chars, before_tab), _mm_cmplt_epi8(chars, after_return));
+			const __m128i delimiters = _mm_or_si128(_mm_cmpeq_epi8(chars, space), whitespace);
+			const __m128i invalid = _mm_andnot_si128(whitespace, control);
+			masks.delimiters |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(delimiters))) << offset;
+			masks.invalid |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(invalid))) << offset;
+		}
+		return masks;
+	}
+
+#if defined(__GNUC__)
+	__attribute__((target("avx2"))) TextBlockMasks ScanAvx2(const char *data)
+	{
+		const __m256i space = _mm256_set1_epi8(' ');
+		const __m256i before_tab = _mm256_set1_epi8('\t' - 1);
+		const __m256i after_return = _mm256_set1_epi8('\r' + 1);
+		const __m256i minus_one = _mm256_set1_epi8(-1);
+
+		TextBlockMasks masks{0, 0};
+		for (size_t offset = 0; offset < TEXT_BLOCK_SIZE; offset += 32)
+		{
+			const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + offset));
+			const __m256i control = _mm256_and_si256(_mm256_cmpgt_epi8(space, chars), _mm256_cmpgt_epi8(chars, minus_one));
+			const __m256i whitespace = _mm256_and_si256(_mm256_cmpgt_epi8(chars, before_tab), _mm256_cmpgt_epi8(after_return, chars));
+			const __m256i delimiters = _mm256_or_si256(_mm256_cmpeq_epi8(chars, space), whitespace);
+			const __m256i invalid = _mm256_andnot_si256(whitespace, control);
+			masks.delimiters |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(delimiters))) << offset;
+			masks.invalid |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(invalid))) << offset;
+		}
+		return masks;
+	}
+#endif
+#endif
+
+	// nullptr if the build or the processor lacks the kernel
+	ScanFunction GetScanFunction(TextScanKernel kernel)
+	{
+		switch (kernel)
+		{
+		case TextScanKernel::SCALAR:
+			return ScanScalar;
+#ifdef TEXT_SCANNER_X86_64
+		case TextScanKernel::SSE2:
+			return ScanSse2;
+#if defined(__GNUC__)
+		case TextScanKernel::AVX2:
+			return __builtin_cpu_supports("avx2") ? ScanAvx2 : nullptr;
+#endif
+#endif
+		default:
+			return nullptr;
+		}
+	}
+
+	ScanFunction SelectScanFunction()
+	{
+		for (const TextScanKernel kernel : {TextScanKernel::AVX2, TextScanKernel::SSE2})
+		{
+			if (const ScanFunction scan = GetScanFunction(kernel))
+			{
+				return scan;
+			}
+		}
+		return ScanScalar;
+	}
+
+	TextBlockMasks ScanTextBlock(ScanFunction scan, const char *data, size_t size)
+	{
+		if (size >= TEXT_BLOCK_SIZE)
+		{
+			return scan(data);
+		}
+		// the kernels always read a whole block, so a short tail is padded with spaces
+		char block[TEXT_BLOCK_SIZE];
+		memcpy(block, data, size);
+		memset(block + size, ' ', TEXT_BLOCK_SIZE - size);
+		return scan(block);
+	}
+}
+
+TextBlockMasks ScanTextBlock(const char *data, size_t size)
+{
+	static const ScanFunction scan = SelectScanFunction();
+	return ScanTextBlock(scan, data, size);
+}
+
+TextBlockMasks ScanTextBlock(const char *data, size_t size, TextScanKernel kernel)
+{
+	const ScanFunction scan = GetScanFunction(kernel);
+	if (scan == nullptr)
+	{
+		throw invalid_argument("Text scan kernel is not supported"s);
+	}
+	return ScanTextBlock(scan, data, size);
+}
+
+bool IsTextScanKernelSupported(TextScanKernel kernel)
+{
+	return GetScanFunction(kernel) != nullptr;
+}
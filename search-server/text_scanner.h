@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Texts are classified in blocks of 64 bytes, one mask bit per byte
+const size_t TEXT_BLOCK_SIZE = 64;
+
+struct TextBlockMasks
+{
+	// spaces and the other ASCII whitespace characters \t \n \v \f \r
+	uint64_t delimiters;
+	// control characters that are not whitespace, a word containing one is invalid
+	uint64_t invalid;
+};
+
+// Implementations of ScanTextBlock; all of them classify every byte alike
+enum class TextScanKernel
+{
+	SCALAR,
+	SSE2,
+	AVX2,
+};
+
+// Classifies data[0, size), size <= TEXT_BLOCK_SIZE. Bytes past size count as delimiters.
+// Uses AVX2 or SSE2 when the processor supports them and a scalar loop otherwise.
+[[nodiscard]] TextBlockMasks ScanTextBlock(const char *data, size_t size);
+// Same with the given kernel, which must be supported by the build and the processor
+[[nodiscard]] TextBlockMasks ScanTextBlock(const char *data, size_t size, TextScanKernel kernel);
+[[nodiscard]] bool IsTextScanKernelSupported(TextScanKernel kernel);
+
+[[nodiscard]] inline int CountTrailingZeros(uint64_t mask)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(mask);
+#else
+	int count = 0;
+	for (; (mask & 1) == 0; mask >>= 1)
+	{
+		++count;
+	}
+	return count;
+#endif
+}
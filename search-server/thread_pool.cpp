@@ -0,0 +1,143 @@
+#include "thread_pool.h"
+
+using namespace std;
+
+namespace
+{
+	// pool and worker index of the calling thread, set for the lifetime of a worker
+	thread_local const ThreadPool *current_pool = nullptr;
+	thread_local size_t current_worker_index = 0;
+}
+
+ThreadPool::ThreadPool(size_t thread_count)
+{
+	queues_.reserve(thread_count);
+	for (size_t i = 0; i < thread_count; ++i)
+	{
+		queues_.push_back(make_unique<WorkerQueue>());
+	}
+	threads_.reserve(thread_count);
+	for (size_t i = 0; i < thread_count; ++i)
+	{
+		threads_.emplace_back([this, i]
+							  { RunWorker(i); });
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		lock_guard guard(sleep_mutex_);
+		is_stopping_ = true;
+	}
+	wake_up_.notify_all();
+	for (thread &worker : threads_)
+	{
+		worker.join();
+	}
+}
+
+size_t ThreadPool::GetThreadCount() const
+{
+	return threads_.size();
+}
+
+ThreadPool &ThreadPool::GetDefault()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::Post(Task task)
+{
+	if (queues_.empty())
+	{
+		task();
+		return;
+	}
+	Push(move(task));
+}
+
+void ThreadPool::Push(Task task)
+{
+	size_t queue_index = GetCurrentWorkerIndex();
+	if (queue_index == queues_.size())
+	{
+		queue_index = next_queue_.fetch_add(1, memory_order_relaxed) % queues_.size();
+	}
+	{
+		lock_guard guard(queues_[queue_index]->mutex);
+		queues_[queue_index]->tasks.push_back(move(task));
+	}
+	queued_count_.fetch_add(1, memory_order_release);
+	// taking the lock orders the count against a worker that is about to fall asleep
+	{
+		lock_guard guard(sleep_mutex_);
+	}
+	wake_up_.notify_one();
+}
+
+bool ThreadPool::TryRunTask()
+{
+	if (queued_count_.load(memory_order_acquire) == 0)
+	{
+		return false;
+	}
+	const size_t own_index = GetCurrentWorkerIndex();
+	Task task;
+	if (own_index < queues_.size())
+	{
+		WorkerQueue &own = *queues_[own_index];
+		lock_guard guard(own.mutex);
+		if (!own.tasks.empty())
+		{
+			task = move(own.tasks.back());
+			own.tasks.pop_back();
+		}
+	}
+	// steal the oldest task, it is likely the largest piece of work left
+	for (size_t offset = 1; !task && offset <= queues_.size(); ++offset)
+	{
+		WorkerQueue &victim = *queues_[(own_index + offset) % queues_.size()];
+		lock_guard guard(victim.mutex);
+		if (!victim.tasks.empty())
+		{
+			task = move(victim.tasks.front());
+			victim.tasks.pop_front();
+		}
+	}
+	if (!task)
+	{
+		return false;
+	}
+	queued_count_.fetch_sub(1, memory_order_relaxed);
+	task();
+	return true;
+}
+
+void ThreadPool::RunWorker(size_t worker_index)
+{
+	current_pool = this;
+	current_worker_index = worker_index;
+	while (true)
+	{
+		if (TryRunTask())
+		{
+			continue;
+		}
+		unique_lock lock(sleep_mutex_);
+		wake_up_.wait(lock, [this]
+					  { return is_stopping_ || queued_count_.load(memory_order_acquire) > 0; });
+		// a stopping pool still runs what is queued; the tasks a running one posts are left
+		// to its own worker, which looks for them before it gets here
+		if (is_stopping_ && queued_count_.load(memory_order_acquire) == 0)
+		{
+			return;
+		}
+	}
+}
+
+size_t ThreadPool::GetCurrentWorkerIndex() const
+{
+	return current_pool == this ? current_worker_index : queues_.size();
+}
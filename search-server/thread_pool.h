@@ -0,0 +1,148 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent pool of worker threads with work-stealing deques. Every worker runs the
+// tasks of its own deque newest first and steals the oldest task of another deque when
+// its own is empty. Tasks submitted from outside the pool are dealt round-robin.
+// Workers live as long as the pool, so thread_local scratch buffers of the scoring code
+// are allocated once per worker and reused by every query it runs.
+class ThreadPool
+{
+public:
+	// With thread_count 0 every ParallelFor runs on the calling thread
+	explicit ThreadPool(size_t thread_count = std::max(1u, std::thread::hardware_concurrency()));
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+	// Runs every queued task, and the tasks they post, before joining the workers, so
+	// no promise a task was to fulfil is broken. Nothing may be posted from outside then.
+	~ThreadPool();
+
+	[[nodiscard]] size_t GetThreadCount() const;
+
+	using Task = std::function<void()>;
+
+	// Queues task and returns without waiting for it. A worker runs the tasks it posted
+	// before its older ones, so a task that continues the work of its poster usually runs
+	// next on the same thread. With no threads the task runs at once.
+	// The task must not throw.
+	void Post(Task task);
+
+	// Calls func(index) for every index of [0, count) and returns when all calls are done.
+	// The calling thread takes part and runs other tasks of the pool while it waits, so
+	// ParallelFor may be nested in a task. The first exception thrown by func is rethrown.
+	template <typename Func>
+	void ParallelFor(size_t count, Func &&func);
+
+	// Pool of hardware_concurrency threads, started on first use
+	[[nodiscard]] static ThreadPool &GetDefault();
+
+private:
+	struct WorkerQueue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	// Indexes of one ParallelFor call, claimed one by one by the caller and the helper tasks
+	struct Batch
+	{
+		size_t count = 0;
+		std::atomic<size_t> next_index{0};
+		std::atomic<size_t> done_count{0};
+		std::mutex mutex;
+		std::condition_variable done;
+		std::exception_ptr error;
+	};
+
+	std::vector<std::unique_ptr<WorkerQueue>> queues_;
+	std::vector<std::thread> threads_;
+	std::atomic<size_t> next_queue_{0};
+	// tasks pushed and not yet taken by any thread
+	std::atomic<size_t> queued_count_{0};
+	std::mutex sleep_mutex_;
+	std::condition_variable wake_up_;
+	bool is_stopping_ = false;
+
+	void Push(Task task);
+	// Takes a task from the deque of the calling worker or steals one; false if there is none
+	bool TryRunTask();
+	void RunWorker(size_t worker_index);
+	// Worker index of the calling thread in this pool, queues_.size() for other threads
+	[[nodiscard]] size_t GetCurrentWorkerIndex() const;
+
+	template <typename Func>
+	static void RunBatch(Batch &batch, Func *func);
+};
+
+template <typename Func>
+void ThreadPool::ParallelFor(size_t count, Func &&func)
+{
+	if (count == 0)
+	{
+		return;
+	}
+	auto batch = std::make_shared<Batch>();
+	batch->count = count;
+
+	// a helper that starts after the last index was claimed does not touch func,
+	// so it only has to keep the batch alive
+	const size_t helper_count = std::min(count - 1, queues_.size());
+	for (size_t i = 0; i < helper_count; ++i)
+	{
+		Push([batch, function = &func]
+			 { RunBatch(*batch, function); });
+	}
+	RunBatch(*batch, &func);
+
+	while (batch->done_count.load(std::memory_order_acquire) < count)
+	{
+		if (!TryRunTask())
+		{
+			// the remaining indexes are running on other threads
+			std::unique_lock lock(batch->mutex);
+			batch->done.wait(lock, [&batch, count]
+							 { return batch->done_count.load(std::memory_order_acquire) == count; });
+		}
+	}
+	// taken out of the batch, which a late helper may still hold
+	if (std::exception_ptr error = std::move(batch->error))
+	{
+		std::rethrow_exception(error);
+	}
+}
+
+template <typename Func>
+void ThreadPool::RunBatch(Batch &batch, Func *func)
+{
+	for (size_t index = batch.next_index.fetch_add(1, std::memory_order_relaxed); index < batch.count;
+		 index = batch.next_index.fetch_add(1, std::memory_order_relaxed))
+	{
+		try
+		{
+			(*func)(index);
+		}
+		catch (...)
+		{
+			std::lock_guard guard(batch.mutex);
+			if (!batch.error)
+			{
+				batch.error = std::current_exception();
+			}
+		}
+		if (batch.done_count.fetch_add(1, std::memory_order_acq_rel) + 1 == batch.count)
+		{
+			std::lock_guard guard(batch.mutex);
+			batch.done.notify_all();
+		}
+	}
+}
@@ -0,0 +1,71 @@
+#include "top_documents.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace
+{
+	// a collector asked for all results, with a top_count like SIZE_MAX, grows with them
+	// instead of reserving its bound up front
+	const size_t MAX_RESERVED_DOCUMENT_COUNT = 64;
+}
+
+TopDocuments::TopDocuments(size_t top_count)
+	: top_count_(top_count)
+{
+	heap_.reserve(min(top_count_, MAX_RESERVED_DOCUMENT_COUNT));
+}
+
+void TopDocuments::Add(const Document &document)
+{
+	if (heap_.size() < top_count_)
+	{
+		heap_.push_back(document);
+		push_heap(heap_.begin(), heap_.end(), IsBetter);
+	}
+	else if (top_count_ > 0 && IsBetter(document, heap_.front()))
+	{
+		pop_heap(heap_.begin(), heap_.end(), IsBetter);
+		heap_.back() = document;
+		push_heap(heap_.begin(), heap_.end(), IsBetter);
+	}
+}
+
+void TopDocuments::Merge(const TopDocuments &other)
+{
+	for (const Document &document : other.heap_)
+	{
+		Add(document);
+	}
+}
+
+size_t TopDocuments::size() const
+{
+	return heap_.size();
+}
+
+size_t TopDocuments::capacity() const
+{
+	return top_count_;
+}
+
+vector<Document> TopDocuments::Extract() &&
+{
+	sort_heap(heap_.begin(), heap_.end(), IsBetter);
+	return move(heap_);
+}
+
+bool TopDocuments::IsBetter(const Document &lhs, const Document &rhs)
+{
+	if (abs(lhs.relevance - rhs.relevance) < precision)
+	{
+		if (lhs.rating == rhs.rating)
+		{
+			return lhs.id < rhs.id;
+		}
+		return lhs.rating > rhs.rating;
+	}
+	return lhs.relevance > rhs.relevance;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include "document.h"
+
+const double precision = 1e-10;
+
+// Bounded collector of the best documents seen so far.
+// Keeps at most top_count documents in a heap whose front is the worst of them,
+// so feeding N documents costs O(N log K) instead of sorting all N.
+class TopDocuments
+{
+public:
+	explicit TopDocuments(size_t top_count);
+
+	void Add(const Document &document);
+	void Merge(const TopDocuments &other);
+
+	[[nodiscard]] size_t size() const;
+	[[nodiscard]] size_t capacity() const;
+
+	// Relevance a new document has to come within precision of to be collected:
+	// the worst collected one once the collector is full, -infinity before
+	[[nodiscard]] double GetAdmissionThreshold() const
+	{
+		if (heap_.size() < top_count_)
+		{
+			return -std::numeric_limits<double>::infinity();
+		}
+		return top_count_ == 0 ? std::numeric_limits<double>::infinity() : heap_.front().relevance;
+	}
+
+	// Returns the collected documents ordered from the most relevant one
+	[[nodiscard]] std::vector<Document> Extract() &&;
+
+	// Order of FindTopDocuments results: relevance (within precision), then rating, then id
+	[[nodiscard]] static bool IsBetter(const Document &lhs, const Document &rhs);
+
+private:
+	size_t top_count_;
+	std::vector<Document> heap_;
+};